@@ -0,0 +1,53 @@
+/**
+ *  Measures the round trip of a small message over fc::make_pipe between two
+ *  fc::threads, and between two fibers of the same thread.
+ *
+ *  usage: bench_pipe_ping_pong [round_trips] [message_size]
+ */
+#include <fc/io/pipe.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/time.hpp>
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+/** @return the mean round trip in microseconds */
+static double run( fc::thread* peer, int round_trips, size_t size ) {
+  std::pair<fc::iostream_ptr,fc::iostream_ptr> p = fc::make_pipe();
+  fc::iostream_ptr far = p.second;
+  auto echo = [=]() {
+    std::vector<char> buf( size );
+    for( int i = 0; i < round_trips + 1; ++i ) {
+      far->read( buf.data(), size );
+      far->write( buf.data(), size );
+    }
+  };
+  fc::future<void> done = peer ? peer->async( echo ) : fc::async( echo );
+
+  std::vector<char> msg( size, 'x' );
+  std::vector<char> reply( size );
+  // the first round trip warms up both ends
+  p.first->write( msg.data(), size );
+  p.first->read( reply.data(), size );
+
+  fc::time_point start = fc::time_point::now();
+  for( int i = 0; i < round_trips; ++i ) {
+    p.first->write( msg.data(), size );
+    p.first->read( reply.data(), size );
+  }
+  fc::microseconds el = fc::time_point::now() - start;
+  done.wait();
+  return double( el.count() ) / round_trips;
+}
+
+int main( int argc, char** argv ) {
+  int    round_trips = argc > 1 ? atoi( argv[1] ) : 100000;
+  size_t size        = argc > 2 ? atoi( argv[2] ) : 64;
+
+  fc::thread peer( "pipe_peer" );
+  std::cout << "fc::make_pipe ping-pong, " << round_trips << " round trips of " << size << " bytes\n";
+  std::cout << "  two threads:          " << run( &peer, round_trips, size ) << " us\n";
+  std::cout << "  two fibers, 1 thread: " << run( nullptr, round_trips, size ) << " us\n";
+  peer.quit();
+  return 0;
+}
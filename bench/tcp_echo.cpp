@@ -0,0 +1,76 @@
+/**
+ *  Measures the round trip of a small message echoed over a loopback tcp
+ *  connection, with fc::asio::read_some/write_some on sockets in blocking mode,
+ *  where every call starts an async operation, and in non-blocking mode, where
+ *  they try the synchronous call first.  Both ends run as fibers of the same
+ *  thread.
+ *
+ *  usage: bench_tcp_echo [round_trips] [message_size]
+ */
+#include <fc/asio.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/time.hpp>
+#include <iostream>
+#include <stdlib.h>
+
+namespace bip = boost::asio::ip;
+
+static void read_all( bip::tcp::socket& s, char* buf, size_t len ) {
+  while( len ) {
+    size_t r = fc::asio::read_some( s, boost::asio::buffer( buf, len ) );
+    buf += r; len -= r;
+  }
+}
+
+static void write_all( bip::tcp::socket& s, const char* buf, size_t len ) {
+  while( len ) {
+    size_t w = fc::asio::write_some( s, boost::asio::buffer( buf, len ) );
+    buf += w; len -= w;
+  }
+}
+
+/** @return the mean round trip in microseconds */
+static double run( bool non_blocking, int round_trips, size_t size ) {
+  boost::asio::io_service& ios = fc::asio::default_io_service();
+  bip::tcp::acceptor acc( ios, bip::tcp::endpoint( bip::address_v4::loopback(), 0 ) );
+  bip::tcp::socket client( ios ), server( ios );
+  client.connect( acc.local_endpoint() );
+  acc.accept( server );
+  client.set_option( bip::tcp::no_delay( true ) );
+  server.set_option( bip::tcp::no_delay( true ) );
+  client.non_blocking( non_blocking );
+  server.non_blocking( non_blocking );
+
+  fc::future<void> echo = fc::async( [&]() {
+    std::vector<char> buf( size );
+    for( int i = 0; i < round_trips + 1; ++i ) {
+      read_all( server, buf.data(), size );
+      write_all( server, buf.data(), size );
+    }
+  } );
+
+  std::vector<char> msg( size, 'x' );
+  std::vector<char> reply( size );
+  // the first round trip warms up both ends
+  write_all( client, msg.data(), size );
+  read_all( client, reply.data(), size );
+
+  fc::time_point start = fc::time_point::now();
+  for( int i = 0; i < round_trips; ++i ) {
+    write_all( client, msg.data(), size );
+    read_all( client, reply.data(), size );
+  }
+  fc::microseconds el = fc::time_point::now() - start;
+  echo.wait();
+  return double( el.count() ) / round_trips;
+}
+
+int main( int argc, char** argv ) {
+  int    round_trips = argc > 1 ? atoi( argv[1] ) : 100000;
+  size_t size        = argc > 2 ? atoi( argv[2] ) : 64;
+
+  std::cout << "tcp loopback echo, " << round_trips << " round trips of " << size << " bytes\n";
+  std::cout << "  blocking sockets (async only):     " << run( false, round_trips, size ) << " us\n";
+  std::cout << "  non-blocking sockets (sync first): " << run( true, round_trips, size ) << " us\n";
+  return 0;
+}
@@ -5,6 +5,8 @@
 #pragma once
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <type_traits>
 #include <fc/thread/future.hpp>
 #include <fc/io/iostream.hpp>
 
@@ -30,6 +32,7 @@ namespace asio {
                               const boost::system::error_code& ec );
         void error_handler_ec( promise<boost::system::error_code>* p, 
                               const boost::system::error_code& ec ); 
+        void record_completion();
 
         template<typename C>
         struct non_blocking { 
@@ -37,6 +40,105 @@ namespace asio {
           bool operator()( C& c, bool s ) { c.non_blocking(s); return true; } 
         };
 
+        /** aborts the operations pending on an asio object, used when a deadline passes */
+        template<typename C>
+        struct canceler {
+          canceler( C& c ):_c(c){}
+          void operator()() { 
+            boost::system::error_code ignored;
+            _c.cancel( ignored ); 
+          }
+          C& _c;
+        };
+
+        /**
+         *  Throws the fc exception matching ec, called by the waiting fiber so that
+         *  nothing is formatted on the reactor thread.
+         */
+        NO_RETURN void throw_error( const boost::system::error_code& ec );
+
+        class slot_handler;
+
+        /**
+         *  The heap state of a completion_slot.  It is allocated once per slot and kept
+         *  alive by every handler referencing it, so an operation that completes after its
+         *  socket has been destroyed does not touch freed memory.
+         */
+        class completion_state : public promise<size_t> {
+          public:
+            typedef fc::shared_ptr<completion_state> ptr;
+            completion_state( const char* desc )
+            :promise_base(desc),promise<size_t>(desc),_memory_used(false){}
+
+            void reset() { this->_reset(); _ec.clear(); }
+            /**
+             *  @return true once only the slot refers to the state: no handler of an
+             *  operation that would still complete into it, and no notification of its
+             *  completion on the way to the waiting thread, holds it anymore
+             */
+            bool unshared()const {
+              if( this->retain_count() != 1 ) return false;
+              boost::atomic_thread_fence( boost::memory_order_acquire );
+              return true;
+            }
+            void complete( const boost::system::error_code& ec, size_t bytes_transferred ) {
+              _ec = ec;
+              this->set_value( bytes_transferred );
+            }
+            const boost::system::error_code& error_code()const { return _ec; }
+
+            /** storage for the asio operation, handed out by the handler allocation hooks */
+            void* allocate( size_t size ) {
+              if( !_memory_used && size <= sizeof(_memory) ) {
+                _memory_used = true;
+                return &_memory;
+              }
+              return ::operator new(size);
+            }
+            void deallocate( void* p ) {
+              if( p == &_memory ) _memory_used = false;
+              else ::operator delete(p);
+            }
+
+          private:
+            boost::system::error_code                             _ec;
+            bool                                                  _memory_used;
+            std::aligned_storage<256,sizeof(void*)>::type         _memory;
+        };
+
+        /**
+         *  Completion handler used with a completion_slot, copying it only adjusts a
+         *  reference count.
+         */
+        class slot_handler {
+          public:
+            explicit slot_handler( const completion_state::ptr& s ):_state(s){}
+
+            /** 
+             *  The reference is dropped as soon as the state is complete rather than when
+             *  asio destroys the handler, so the slot can usually reuse it right away.
+             */
+            void operator()( const boost::system::error_code& ec, size_t bytes_transferred ) {
+              record_completion();
+              completion_state::ptr s;
+              std::swap( s, _state );
+              s->complete( ec, bytes_transferred );
+            }
+            void operator()( const boost::system::error_code& ec ) {
+              (*this)( ec, 0 );
+            }
+
+            friend void* asio_handler_allocate( size_t size, slot_handler* h ) {
+              return h->_state->allocate( size );
+            }
+            friend void asio_handler_deallocate( void* p, size_t, slot_handler* h ) {
+              h->_state->deallocate( p );
+            }
+
+          private:
+            completion_state::ptr _state;
+        };
+
         #if WIN32  // windows stream handles do not support non blocking!
 	       template<>
          struct non_blocking<boost::asio::windows::stream_handle> { 
@@ -54,6 +156,102 @@ namespace asio {
      */
     boost::asio::io_service& default_io_service(bool cleanup = false);
 
+    /**
+     *  Sets the number of reactors (an io_service each with its own thread) that are
+     *  started the first time an io_service is requested.  If this is never called the
+     *  FC_ASIO_THREADS environment variable is used, otherwise a single reactor is run.
+     *
+     *  @pre no io_service has been requested yet, later calls have no effect.
+     */
+    void set_num_io_threads( uint32_t n );
+
+    /**
+     *  @return the io_service of the next reactor in round-robin order.  All completion
+     *  handlers of objects created with it run on that reactor's thread, so new
+     *  sockets should be created with this rather than default_io_service().
+     */
+    boost::asio::io_service& next_io_service();
+
+    /**
+     *  Load counters of a single reactor, used to check that sockets are evenly
+     *  sharded across the io threads.
+     */
+    struct reactor_stats
+    {
+       reactor_stats():index(0),assigned(0),completions(0){}
+       uint32_t index;
+       uint64_t assigned;    ///< objects given this reactor by next_io_service()
+       uint64_t completions; ///< fc::asio completion handlers run by this reactor
+    };
+    std::vector<reactor_stats> get_reactor_stats();
+
+    /**
+     *  @brief reusable completion state for one outstanding operation at a time.
+     *
+     *  Sockets keep one slot per direction so that steady state reads and writes do
+     *  not allocate: the promise and the memory for the asio operation are created
+     *  once and reset for every operation.  Errors are handed back as error codes,
+     *  the exception is only constructed by the fiber that waits on the slot.
+     */
+    class completion_slot {
+      public:
+        completion_slot( const char* desc = "fc::asio::completion_slot" )
+        :_state( new detail::completion_state(desc) ),_started(0){}
+
+        /**
+         *  The operation started before may have been abandoned by a fiber canceled
+         *  while waiting on it and still be pending, or the notification of its
+         *  completion may not have arrived yet.  The old state is then left to them and
+         *  the slot continues with a new one, so a late completion never fulfills the
+         *  next operation.
+         */
+        detail::slot_handler handler() {
+          ++_started;
+          if( _state->unshared() ) _state->reset();
+          else _state = detail::completion_state::ptr( new detail::completion_state( _state->get_desc() ) );
+          return detail::slot_handler( _state );
+        }
+
+        /** @return the bytes transferred, ec is set on failure */
+        size_t wait( boost::system::error_code& ec ) {
+          size_t r = _state->wait();
+          ec = _state->error_code();
+          return r;
+        }
+
+        /**
+         *  Like wait() but once deadline passes cancel() is called and the aborted
+         *  operation is waited for, so the slot can be reused without another timer.
+         *  ec is then boost::asio::error::timed_out, unless the operation finished
+         *  before it could be aborted, in which case its result is kept.
+         */
+        template<typename Cancel>
+        size_t wait_until( const time_point& deadline, Cancel cancel, boost::system::error_code& ec ) {
+          bool canceled = false;
+          if( deadline != time_point::maximum() ) {
+            try {
+              size_t r = _state->wait_until( deadline );
+              ec = _state->error_code();
+              return r;
+            } catch ( const timeout_exception& ) {
+              canceled = true;
+              cancel();
+            }
+          }
+          size_t r = _state->wait();
+          ec = _state->error_code();
+          if( canceled && ec == boost::asio::error::operation_aborted ) ec = boost::asio::error::timed_out;
+          return r;
+        }
+
+        /** @return the number of async operations started with this slot */
+        uint64_t started()const { return _started; }
+
+      private:
+        detail::completion_state::ptr _state;
+        uint64_t                      _started;
+    };
+
     /** 
      *  @brief wraps boost::asio::async_read
      *  @pre s.non_blocking() == true
@@ -69,8 +267,8 @@ namespace asio {
      *  This method will read at least 1 byte from the stream and will
      *  cooperatively block until that byte is available or an error occurs.
      *  
-     *  If the stream is not in 'non-blocking' mode it will be put in 'non-blocking'
-     *  mode it the stream supports s.non_blocking() and s.non_blocking(bool).
+     *  The owner of the stream opts in by calling s.non_blocking(true), streams that
+     *  may be shared with other processes (pipes) are left alone.
      *
      *  If in non blocking mode, the call will be synchronous avoiding heap allocs
      *  and context switching. If the sync call returns 'would block' then an
@@ -81,6 +279,12 @@ namespace asio {
     template<typename AsyncReadStream, typename MutableBufferSequence>
     size_t read_some( AsyncReadStream& s, const MutableBufferSequence& buf ) 
     {
+        if( detail::non_blocking<AsyncReadStream>()(s) ) {
+            boost::system::error_code ec;
+            size_t r = s.read_some( buf, ec );
+            if( !ec ) return r;
+            if( ec != boost::asio::error::would_block ) detail::throw_error( ec );
+        }
         promise<size_t>::ptr p(new promise<size_t>("fc::asio::async_read_some"));
         s.async_read_some( buf, boost::bind( detail::read_write_handler, p, _1, _2 ) );
         return p->wait();
@@ -106,23 +310,154 @@ namespace asio {
     }
 
     /** 
-     *  @pre s.non_blocking() == true
      *  @brief wraps boost::asio::async_write_some
+     *
+     *  Like read_some() a stream in non-blocking mode is written synchronously first
+     *  and the async write is only started if the call would block.
+     *
      *  @return the number of bytes written
      */
     template<typename AsyncWriteStream, typename ConstBufferSequence>
     size_t write_some( AsyncWriteStream& s, const ConstBufferSequence& buf ) {
+        if( detail::non_blocking<AsyncWriteStream>()(s) ) {
+            boost::system::error_code ec;
+            size_t r = s.write_some( buf, ec );
+            if( !ec ) return r;
+            if( ec != boost::asio::error::would_block ) detail::throw_error( ec );
+        }
         promise<size_t>::ptr p(new promise<size_t>("fc::asio::write_some"));
         s.async_write_some( buf, boost::bind( detail::read_write_handler, p, _1, _2 ) );
         return p->wait();
     }
 
+    /**
+     *  @brief read_some() reusing the completion state of slot
+     *  @return the number of bytes read, 0 with ec set on error
+     */
+    template<typename AsyncReadStream, typename MutableBufferSequence>
+    size_t read_some( AsyncReadStream& s, const MutableBufferSequence& buf, 
+                      completion_slot& slot, boost::system::error_code& ec ) {
+        if( detail::non_blocking<AsyncReadStream>()(s) ) {
+            size_t r = s.read_some( buf, ec );
+            if( ec != boost::asio::error::would_block ) return r;
+        }
+        s.async_read_some( buf, slot.handler() );
+        return slot.wait( ec );
+    }
+    template<typename AsyncReadStream, typename MutableBufferSequence>
+    size_t read_some( AsyncReadStream& s, const MutableBufferSequence& buf, completion_slot& slot ) {
+        boost::system::error_code ec;
+        size_t r = read_some( s, buf, slot, ec );
+        if( ec ) detail::throw_error( ec );
+        return r;
+    }
+
+    /**
+     *  @brief read_some() that gives up at deadline
+     *
+     *  The pending read is canceled with s.cancel(), which aborts any other operation
+     *  waiting on s as well.  s is left open and no data is lost.
+     *
+     *  @throw timeout_exception
+     */
+    template<typename AsyncReadStream, typename MutableBufferSequence>
+    size_t read_some( AsyncReadStream& s, const MutableBufferSequence& buf, 
+                      completion_slot& slot, const time_point& deadline ) {
+        boost::system::error_code ec;
+        if( detail::non_blocking<AsyncReadStream>()(s) ) {
+            size_t r = s.read_some( buf, ec );
+            if( ec != boost::asio::error::would_block ) {
+              if( ec ) detail::throw_error( ec );
+              return r;
+            }
+        }
+        s.async_read_some( buf, slot.handler() );
+        size_t r = slot.wait_until( deadline, detail::canceler<AsyncReadStream>(s), ec );
+        if( ec ) detail::throw_error( ec );
+        return r;
+    }
+
+    /**
+     *  @brief write_some() reusing the completion state of slot
+     *  @return the number of bytes written, 0 with ec set on error
+     */
+    template<typename AsyncWriteStream, typename ConstBufferSequence>
+    size_t write_some( AsyncWriteStream& s, const ConstBufferSequence& buf, 
+                       completion_slot& slot, boost::system::error_code& ec ) {
+        if( detail::non_blocking<AsyncWriteStream>()(s) ) {
+            size_t r = s.write_some( buf, ec );
+            if( ec != boost::asio::error::would_block ) return r;
+        }
+        s.async_write_some( buf, slot.handler() );
+        return slot.wait( ec );
+    }
+    template<typename AsyncWriteStream, typename ConstBufferSequence>
+    size_t write_some( AsyncWriteStream& s, const ConstBufferSequence& buf, completion_slot& slot ) {
+        boost::system::error_code ec;
+        size_t r = write_some( s, buf, slot, ec );
+        if( ec ) detail::throw_error( ec );
+        return r;
+    }
+
+    /** @brief write() reusing the completion state of slot */
+    template<typename AsyncWriteStream, typename ConstBufferSequence>
+    size_t write( AsyncWriteStream& s, const ConstBufferSequence& buf, completion_slot& slot ) {
+        boost::asio::async_write( s, buf, slot.handler() );
+        boost::system::error_code ec;
+        size_t r = slot.wait( ec );
+        if( ec ) detail::throw_error( ec );
+        return r;
+    }
+
+    /**
+     *  Cooperatively waits until s can be read without blocking, used to drive
+     *  system calls asio does not wrap (splice, sendfile, recvmmsg) from a fiber.
+     */
+    template<typename AsyncReadStream>
+    void wait_readable( AsyncReadStream& s, completion_slot& slot ) {
+        s.async_read_some( boost::asio::null_buffers(), slot.handler() );
+        boost::system::error_code ec;
+        slot.wait( ec );
+        if( ec ) detail::throw_error( ec );
+    }
+    /** @brief like wait_readable() for writing */
+    template<typename AsyncWriteStream>
+    void wait_writable( AsyncWriteStream& s, completion_slot& slot ) {
+        s.async_write_some( boost::asio::null_buffers(), slot.handler() );
+        boost::system::error_code ec;
+        slot.wait( ec );
+        if( ec ) detail::throw_error( ec );
+    }
+
     namespace tcp {
         typedef boost::asio::ip::tcp::endpoint endpoint;
         typedef boost::asio::ip::tcp::resolver::iterator resolver_iterator;
         typedef boost::asio::ip::tcp::resolver resolver;
+        /**
+         *  Results are cached process wide, see set_resolve_cache_ttl().  Concurrent
+         *  callers resolving the same name share a single lookup.
+         */
         std::vector<endpoint> resolve( const std::string& hostname, const std::string& port );
 
+        /**
+         *  Successful lookups are reused for ttl and failures for negative_ttl.  A zero
+         *  ttl keeps them out of the cache, concurrent lookups are still shared.  Timeouts
+         *  and canceled lookups are never cached.
+         */
+        void set_resolve_cache_ttl( const microseconds& ttl, const microseconds& negative_ttl );
+        /** drops every cached result */
+        void clear_resolve_cache();
+
+        struct resolve_cache_stats
+        {
+           resolve_cache_stats():hits(0),misses(0),shared(0),entries(0){}
+           uint64_t hits;    ///< answered from the cache
+           uint64_t misses;  ///< sent to the resolver
+           uint64_t shared;  ///< waited on a lookup started by another caller
+           uint64_t entries;
+        };
+        resolve_cache_stats get_resolve_cache_stats();
+
         /** @brief wraps boost::asio::async_accept
           * @post sock is connected
           * @post sock.non_blocking() == true  
@@ -148,6 +483,52 @@ namespace asio {
             p->wait();
             //if( ec ) BOOST_THROW_EXCEPTION( boost::system::system_error(ec) );
         }
+
+        /** @brief accept() reusing the completion state of slot */
+        template<typename SocketType, typename AcceptorType>
+        void accept( AcceptorType& acc, SocketType& sock, completion_slot& slot ) {
+            acc.async_accept( sock, slot.handler() );
+            boost::system::error_code ec;
+            slot.wait( ec );
+            if( ec ) fc::asio::detail::throw_error( ec );
+        }
+
+        /** @brief connect() reusing the completion state of slot */
+        template<typename AsyncSocket, typename EndpointType>
+        void connect( AsyncSocket& sock, const EndpointType& ep, completion_slot& slot ) {
+            sock.async_connect( ep, slot.handler() );
+            boost::system::error_code ec;
+            slot.wait( ec );
+            if( ec ) fc::asio::detail::throw_error( ec );
+        }
+
+        /**
+         *  @brief accept() that gives up at deadline, acc stays open
+         *  @throw timeout_exception
+         */
+        template<typename SocketType, typename AcceptorType>
+        void accept( AcceptorType& acc, SocketType& sock, completion_slot& slot, const time_point& deadline ) {
+            acc.async_accept( sock, slot.handler() );
+            boost::system::error_code ec;
+            slot.wait_until( deadline, fc::asio::detail::canceler<AcceptorType>(acc), ec );
+            if( ec ) fc::asio::detail::throw_error( ec );
+        }
+
+        /**
+         *  @brief connect() that gives up at deadline
+         *
+         *  The socket is not closed on timeout but the attempt is abandoned, so it
+         *  has to be closed before it can connect again.
+         *
+         *  @throw timeout_exception
+         */
+        template<typename AsyncSocket, typename EndpointType>
+        void connect( AsyncSocket& sock, const EndpointType& ep, completion_slot& slot, const time_point& deadline ) {
+            sock.async_connect( ep, slot.handler() );
+            boost::system::error_code ec;
+            slot.wait_until( deadline, fc::asio::detail::canceler<AsyncSocket>(sock), ec );
+            if( ec ) fc::asio::detail::throw_error( ec );
+        }
     }
     namespace udp {
         typedef boost::asio::ip::udp::endpoint endpoint;
@@ -2,6 +2,7 @@
 #include <fc/interprocess/iprocess.hpp>
 
 namespace fc {
+  class tcp_socket;
 
   fc::path find_executable_in_path( const fc::string name );
 
@@ -26,6 +27,19 @@ namespace fc {
       virtual fc::buffered_istream_ptr   out_stream();
       virtual fc::buffered_istream_ptr   err_stream();
 
+      /**
+       *  Moves up to length bytes of the child's stdout straight into s with splice(2),
+       *  stopping early when the child closes stdout.  Bytes already buffered by 
+       *  out_stream() are not included, so do not mix the two.
+       *  @return the number of bytes moved
+       */
+      uint64_t copy_out_to( tcp_socket& s, uint64_t length = uint64_t(-1) );
+      /**
+       *  Moves up to length bytes from s straight into the child's stdin, stopping 
+       *  early at the end of the stream.  in_stream() must be flushed first.
+       */
+      uint64_t copy_in_from( tcp_socket& s, uint64_t length = uint64_t(-1) );
+
       class impl;
     private:
       std::unique_ptr<impl> my;
@@ -5,6 +5,22 @@
 
 namespace fc {
 
+  /** a region of memory read by ostream::writev() */
+  struct const_buffer {
+    const_buffer():data(nullptr),size(0){}
+    const_buffer( const char* d, size_t s ):data(d),size(s){}
+    const char* data;
+    size_t      size;
+  };
+
+  /** a region of memory filled by istream::readvsome() */
+  struct mutable_buffer {
+    mutable_buffer():data(nullptr),size(0){}
+    mutable_buffer( char* d, size_t s ):data(d),size(s){}
+    char*  data;
+    size_t size;
+  };
+
   /**
    *  Provides a fc::thread friendly cooperatively multi-tasked stream that
    *  will block 'cooperatively' instead of hard blocking.
@@ -29,6 +45,17 @@ namespace fc {
        **/
       istream&   read( char* buf, size_t len ); 
       char       get();
+
+      /** scatter read, fills the buffers in order with at least 1 byte.
+       *  The default reads into the first non empty buffer only.
+       *  Returns 0 right away if every buffer is empty.
+       *
+       *  @throws fc::eof if at least 1 byte cannot be read
+       **/
+      virtual size_t     readvsome( const mutable_buffer* bufs, size_t count );
+
+      /** fills every buffer or throws, implemented in terms of readvsome */
+      istream&   readv( const mutable_buffer* bufs, size_t count );
   };
   typedef std::shared_ptr<istream> istream_ptr;
 
@@ -50,11 +77,23 @@ namespace fc {
         * but not flushed. 
         **/
        ostream&   write( const char* buf, size_t len );
+
+       /** gather write, sends at least 1 byte taken from the buffers in order.
+        *  The default writes from the first non empty buffer only.
+        *  Returns 0 right away if every buffer is empty.
+        **/
+       virtual size_t     writevsome( const const_buffer* bufs, size_t count );
+
+       /** sends every buffer in order, the default is implemented in terms of 
+        *  writevsome.  Streams override this to send all buffers with one write.
+        **/
+       virtual ostream&   writev( const const_buffer* bufs, size_t count );
   };
 
   typedef std::shared_ptr<ostream> ostream_ptr;
 
   class iostream : public virtual ostream, public virtual istream {};
+  typedef std::shared_ptr<iostream> iostream_ptr;
 
   fc::istream& getline( fc::istream&, fc::string&, char delim = '\n' );
 
@@ -0,0 +1,22 @@
+#pragma once
+#include <fc/io/iostream.hpp>
+#include <utility>
+
+namespace fc {
+
+  /**
+   *  Creates two connected in-memory streams: bytes written to one are read from
+   *  the other.  Each direction is a ring buffer of capacity bytes, readers park
+   *  their fiber while it is empty and writers while it is full.  The two ends 
+   *  may be used from different fc::threads.
+   *
+   *  Closing or destroying one end makes reads on the other end throw 
+   *  fc::eof_exception once the buffered bytes are consumed, and writes to it throw
+   *  right away.
+   *
+   *  This gives a transport without system calls, for connecting components in the
+   *  same process and for benchmarking protocols without the kernel network stack.
+   */
+  std::pair<iostream_ptr,iostream_ptr> make_pipe( size_t capacity = 64*1024 );
+
+} // namespace fc
@@ -0,0 +1,87 @@
+#pragma once
+#include <fc/network/http/parser.hpp>
+#include <fc/io/iostream.hpp>
+
+namespace fc { namespace http {
+
+  /**
+   *  Reads the body of one message from a connection, taking the bytes already in its
+   *  read buffer first.  The body is delimited by a Content-Length, by the chunked
+   *  transfer coding (RFC 7230 4.1) or by the end of the connection.  Chunk extensions
+   *  and trailer fields are skipped.
+   *
+   *  readsome() throws eof_exception at the end of the body, so the stream can be read
+   *  like any other.  A connection closed before the end of a body that has a length
+   *  or is chunked throws parse_error_exception instead.
+   */
+  class body_istream : public fc::istream
+  {
+    public:
+      enum framing_type { content_length, chunked, until_eof };
+
+      /** the most read_all() appends unless told otherwise */
+      static const uint64_t default_max_size = 16*1024*1024;
+
+      /** @param length the length of a content_length body */
+      body_istream( read_buffer& buf, istream& src, framing_type f, uint64_t length = 0 );
+
+      virtual size_t readsome( char* buf, size_t len );
+
+      framing_type   framing()const { return _framing; }
+      /** the length of a content_length body */
+      uint64_t       length()const  { return _length; }
+      /** true once the whole body has been read */
+      bool           done()const    { return _state == finished; }
+      /** the number of body bytes read so far */
+      uint64_t       bytes_read()const { return _read; }
+
+      /** reads and discards the rest of the body */
+      void           skip();
+      /** 
+       *  Appends the rest of the body to out.
+       *  @throw out_of_range_exception if it is longer than max_size, before reading
+       *         any of it if its length is known
+       */
+      void           read_all( std::vector<char>& out, uint64_t max_size = default_max_size );
+      /** writes the rest of the body to out */
+      void           copy_to( fc::ostream& out );
+
+    private:
+      enum state_type { data, chunk_size, chunk_end, trailer, finished };
+
+      /** @return the length of the line at the front of the buffer, including its '\n' */
+      size_t         next_line();
+      size_t         read_data( char* buf, size_t len );
+
+      read_buffer&   _buf;
+      istream&       _src;
+      framing_type   _framing;
+      state_type     _state;
+      uint64_t       _length;
+      uint64_t       _remaining; ///< of the body or of the current chunk
+      uint64_t       _read;
+  };
+
+  /**
+   *  Writes each writesome() to out as one chunk of the chunked transfer coding,
+   *  close() writes the last, empty chunk but leaves out open.
+   */
+  class chunked_ostream : public fc::ostream
+  {
+    public:
+      chunked_ostream( ostream& out );
+
+      virtual size_t writesome( const char* buf, size_t len );
+      virtual void   close();
+      virtual void   flush();
+
+      /** sends data as one chunk, after head if given, with a single write */
+      void           write_chunk( const char* data, size_t len, const const_buffer* head = nullptr );
+      bool           closed()const { return _closed; }
+
+    private:
+      ostream& _out;
+      bool     _closed;
+  };
+
+} } // fc::http
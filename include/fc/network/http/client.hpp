@@ -0,0 +1,88 @@
+#pragma once
+#include <fc/network/http/connection.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/io/iostream.hpp>
+#include <fc/time.hpp>
+#include <memory>
+
+namespace fc { namespace http {
+
+  /**
+   *  Sends requests over pools of keep-alive connections, one pool per host.  Each
+   *  request runs in its own fiber on the thread that created the client, so many
+   *  requests may be in flight at once.  When a host already has the maximum number of
+   *  connections busy, further requests wait for one of them in the order they were made.
+   */
+  class client
+  {
+    public:
+      client( uint32_t max_connections_per_host = 8 );
+      /** waits for the requests in flight */
+      ~client();
+
+      void set_max_connections_per_host( uint32_t n );
+      /** idle connections older than this are closed instead of being reused, 30 seconds by default */
+      void set_idle_timeout( const microseconds& t );
+      /**
+       *  Replies read into reply::body, compressed or not, and decompressed, may be at most
+       *  n bytes long, body_istream::default_max_size by default.  Longer ones fail with
+       *  out_of_range_exception.
+       */
+      void set_max_reply_body( uint64_t n );
+
+      /**
+       *  @param url "http://host[:port]/path[?query]"
+       *
+       *  A request that fails on a reused connection, which the server may have closed
+       *  while it was idle, is retried once on a new connection if its method is
+       *  idempotent or if the server closed the connection without replying.
+       */
+      fc::future<reply> request( const fc::string& method, const fc::string& url,
+                                 const fc::string& body = fc::string(), const headers& h = headers() );
+
+      /**
+       *  Streams the request body from body, if given, with the chunked transfer coding
+       *  and writes the reply body to reply_body, if given, instead of reply::body.
+       *  These requests are never retried.
+       */
+      fc::future<reply> request( const fc::string& method, const fc::string& url,
+                                 const fc::istream_ptr& body, const fc::ostream_ptr& reply_body,
+                                 const headers& h = headers() );
+
+      fc::future<reply> get( const fc::string& url, const headers& h = headers() ) {
+        return request( "GET", url, fc::string(), h );
+      }
+      fc::future<reply> post( const fc::string& url, const fc::string& body, const headers& h = headers() ) {
+        return request( "POST", url, body, h );
+      }
+
+      struct pool_stats
+      {
+         pool_stats():connections(0),idle(0),waiting(0),created(0),reused(0){}
+         fc::string host;
+         uint32_t   connections; ///< open, busy or idle
+         uint32_t   idle;
+         uint32_t   waiting;     ///< requests waiting for a connection
+         uint64_t   created;
+         uint64_t   reused;      ///< requests sent on a connection that was used before
+      };
+      std::vector<pool_stats> get_pool_stats()const;
+
+    private:
+      // non copyable
+      client( const client& );
+      client& operator=( const client& );
+
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+  namespace detail {
+    /**
+     *  Splits "http://host[:port][/target]", the target is "/" if the url has none.
+     *  @throw invalid_arg_exception for another scheme, an empty host or an invalid port
+     */
+    void split_url( const fc::string& url, fc::string& host, uint16_t& port, fc::string& target );
+  }
+
+} } // fc::http
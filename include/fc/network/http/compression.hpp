@@ -0,0 +1,104 @@
+#pragma once
+#include <fc/io/iostream.hpp>
+#include <fc/string.hpp>
+#include <memory>
+#include <vector>
+
+namespace fc { namespace http {
+
+  /** the content codings (RFC 7231 3.1.2.1) bodies may be compressed with */
+  namespace content_coding {
+    enum type {
+      identity = 0,
+      gzip,
+      deflate   ///< the zlib format, as HTTP means it
+    };
+
+    /** @return the coding named by a Content-Encoding value, identity if it is unknown or a list */
+    type        parse( const fc::string& content_encoding );
+    const char* name( type t );
+    /** @return the coding preferred by an Accept-Encoding value, gzip when it is as good as deflate */
+    type        negotiate( const fc::string& accept_encoding );
+    /** 
+     *  @return the entity tag of the body tagged etag once compressed with t, etag with
+     *          the name of t appended inside its quotes, so a strong tag keeps telling
+     *          byte for byte different bodies apart
+     */
+    fc::string  tag( const fc::string& etag, type t );
+  }
+
+  /** @return true for media types that are worth compressing, and for an unknown type */
+  bool is_compressible_type( const fc::string& content_type );
+
+  /** compresses a body, possibly in several pieces */
+  class deflater
+  {
+    public:
+      enum flush_type {
+        no_flush,    ///< zlib may keep the input to compress it better
+        sync_flush,  ///< everything given so far can be decompressed from the output
+        finish       ///< ends the stream
+      };
+
+      /** @param level 0 to 9, faster to smaller */
+      deflater( content_coding::type c, int level = 6 );
+      ~deflater();
+
+      /** appends the compressed len bytes of data to out, as much of it as f lets go of */
+      void compress( const char* data, size_t len, std::vector<char>& out, flush_type f = no_flush );
+
+    private:
+      // non copyable
+      deflater( const deflater& );
+      deflater& operator=( const deflater& );
+
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+  /** decompresses a gzip or deflate body, whichever header it starts with */
+  class inflater
+  {
+    public:
+      inflater();
+      ~inflater();
+
+      /**
+       *  Appends the decompressed len bytes of data to out.
+       *  @return the number of bytes of data used, less than len only once the stream ended
+       *  @throw parse_error_exception if data is not a valid stream
+       *  @throw out_of_range_exception if out would grow beyond max_size bytes
+       */
+      size_t decompress( const char* data, size_t len, std::vector<char>& out, uint64_t max_size = uint64_t(-1) );
+      /** true once the end of the stream was decompressed */
+      bool   done()const;
+
+    private:
+      // non copyable
+      inflater( const inflater& );
+      inflater& operator=( const inflater& );
+
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+  /**
+   *  Reads the decompressed body from src, which must end with the compressed stream.
+   *  @throw parse_error_exception if src ends before the stream does
+   */
+  class inflate_istream : public fc::istream
+  {
+    public:
+      inflate_istream( istream& src );
+
+      virtual size_t readsome( char* buf, size_t len );
+
+    private:
+      istream&          _src;
+      inflater          _inflater;
+      std::vector<char> _in;
+      std::vector<char> _out;
+      size_t            _out_pos;
+  };
+
+} } // fc::http
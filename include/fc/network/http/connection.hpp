@@ -1,13 +1,19 @@
 #pragma once
 #include <fc/vector.hpp>
 #include <fc/string.hpp>
+#include <fc/time.hpp>
+#include <fc/network/http/header_index.hpp>
 #include <memory>
 
 namespace fc { 
   namespace ip { class endpoint; }
   class tcp_socket;
+  typedef std::shared_ptr<tcp_socket> tcp_socket_ptr;
+  class istream;
+  class ostream;
 
   namespace http {
+     class body_istream;
 
      struct header 
      {
@@ -25,24 +31,53 @@ namespace fc {
         enum status_code {
             OK                  = 200,
             RecordCreated       = 201,
-            NotFound            = 404,
+            NoContent           = 204,
+            PartialContent      = 206,
+            MovedPermanently    = 301,
             Found               = 302,
-            InternalServerError = 500
+            NotModified         = 304,
+            BadRequest          = 400,
+            Forbidden           = 403,
+            NotFound            = 404,
+            MethodNotAllowed    = 405,
+            PayloadTooLarge     = 413,
+            RangeNotSatisfiable = 416,
+            InternalServerError = 500,
+            NotImplemented      = 501,
+            ServiceUnavailable  = 503
         };
         reply( status_code c = OK):status(c){}
+        /** the value of the first field named key ignoring case, or an empty string */
+        fc::string get_header( const fc::string& key )const;
+        fc::string get_header( header_id::type id )const;
         int                     status;
         std::vector<header>      headers;
         std::vector<char>        body;
+        /** of headers, extended by the lookups when fields were appended */
+        mutable header_index    header_idx;
      };
      
      struct request 
      {
+        request():keep_alive(false){}
+        /** the value of the first field named key ignoring case, or an empty string */
         fc::string get_header( const fc::string& key )const;
+        fc::string get_header( header_id::type id )const;
         fc::string              method;
         fc::string              domain;
         fc::string              path;
+        fc::string              version;
+        /** the client allows the connection to be reused, following its Connection header and version */
+        bool                    keep_alive;
         std::vector<header>      headers;
         std::vector<char>        body;
+        /** 
+         *  Set instead of body when the server leaves the body to be streamed by the
+         *  callback, see server::set_max_buffered_body()
+         */
+        std::shared_ptr<body_istream> body_stream;
+        /** of headers, extended by the lookups when fields were appended */
+        mutable header_index    header_idx;
      };
      
      std::vector<header> parse_urlencoded_params( const fc::string& f );
@@ -55,15 +90,68 @@ namespace fc {
      {
        public:
          connection();
+         /** serves or sends requests on an already connected socket */
+         connection( const fc::tcp_socket_ptr& s );
          ~connection();
          // used for clients
          void         connect_to( const fc::ip::endpoint& ep );
+         /**
+          *  The most bytes a reply body read into reply::body may have, compressed or
+          *  decompressed, body_istream::default_max_size by default.
+          */
+         void         set_max_reply_body( uint64_t n );
          http::reply  request( const fc::string& method, const fc::string& url, const fc::string& body, const headers& = headers());
+         /**
+          *  Sends a request on the connected socket and reads the reply, closing the
+          *  socket if the server does not keep the connection alive.
+          *
+          *  Unless the headers include Accept-Encoding, the request accepts gzip and
+          *  deflate and a compressed reply is decompressed, without its Content-Encoding
+          *  and Content-Length.
+          *  @param target the path and query of the request
+          *  @param host   the value of the Host header
+          *  @throw out_of_range_exception if the reply body exceeds the limit of
+          *         set_max_reply_body()
+          *  @throw on any error, the socket is closed
+          */
+         http::reply  send_request( const fc::string& method, const fc::string& target, const fc::string& host,
+                                    const fc::string& body, const headers& = headers() );
+         /**
+          *  Streams the request body, if any, with the chunked transfer coding until body
+          *  reaches its end, and writes the reply body to reply_body, if given, instead of
+          *  reply::body.
+          */
+         http::reply  send_request( const fc::string& method, const fc::string& target, const fc::string& host,
+                                    fc::istream* body, fc::ostream* reply_body, const headers& = headers() );
      
          // used for servers
          fc::tcp_socket& get_socket()const;
      
+         /**
+          *  @throw out_of_range_exception if the body is longer than 
+          *         body_istream::default_max_size, read_request_head() lets longer ones
+          *         be streamed
+          */
          http::request    read_request()const;
+         /** 
+          *  @throw timeout_exception if the head of the request has not arrived by deadline,
+          *         the connection is left open
+          */
+         http::request    read_request( const time_point& deadline )const;
+         /**
+          *  Reads only the head of the next request, its body must be read from
+          *  body_stream() before the next request.
+          *  @throw parse_error_exception if the head is malformed, or if it does not
+          *         frame the body unambiguously as RFC 7230 3.3.3 requires: a
+          *         Transfer-Encoding whose last coding is not chunked, one together with
+          *         a Content-Length, or Content-Length fields that disagree
+          */
+         http::request    read_request_head( const time_point& deadline = time_point::maximum() )const;
+         /** 
+          *  The body of the request whose head was read last, valid while the connection 
+          *  exists and until the next request is read.
+          */
+         std::shared_ptr<body_istream> body_stream()const;
 
          class impl;
        private:
@@ -0,0 +1,79 @@
+#pragma once
+#include <fc/network/http/server.hpp>
+#include <fc/filesystem.hpp>
+#include <memory>
+
+namespace fc { namespace http {
+
+  /**
+   *  Serves the files of a directory for the requests whose path starts with a prefix,
+   *  e.g. from a server::on_request callback.
+   *
+   *  Small files are copied into memory and kept in a LRU cache, so they are sent with
+   *  the head in a single write, larger ones are sent with sendfile.  Responses carry
+   *  an ETag derived from the size, the modification time in nanoseconds and the inode
+   *  of the file, answer If-None-Match with 304 and a single byte range with 206.  Files
+   *  are checked for changes on every request.  Safe to use from several worker threads
+   *  at once.
+   */
+  class file_handler
+  {
+    public:
+      /** @param url_prefix e.g. "/static", the rest of the path names a file under root */
+      file_handler( const fc::string& url_prefix, const fc::path& root );
+      ~file_handler();
+
+      /**
+       *  Files up to max_file bytes are cached while the cache holds at most max_total
+       *  bytes, 256 KiB and 64 MiB by default.  A max_file of 0 disables the cache.
+       */
+      void set_cache_limits( uint64_t max_file, uint64_t max_total );
+      /**
+       *  Serves file.gz, with Content-Encoding: gzip, in place of file to clients that
+       *  accept gzip, if it exists and is not older than file.  Off by default.
+       */
+      void set_precompressed( bool on );
+
+      /** @return false, without responding, if the path of r is not under the prefix */
+      bool handle( const request& r, const server::response& rep )const;
+
+      struct stats
+      {
+         stats():cache_hits(0),cache_misses(0),cache_evictions(0),cached_files(0),cached_bytes(0),
+                 sendfile_responses(0),not_modified(0),partial(0),precompressed(0){}
+         uint64_t cache_hits;
+         uint64_t cache_misses;       ///< cacheable files that had to be read
+         uint64_t cache_evictions;
+         uint64_t cached_files;
+         uint64_t cached_bytes;
+         uint64_t sendfile_responses;
+         uint64_t not_modified;       ///< 304 responses
+         uint64_t partial;            ///< 206 responses
+         uint64_t precompressed;      ///< responses that sent a .gz file
+      };
+      stats get_stats()const;
+
+    private:
+      // non copyable
+      file_handler( const file_handler& );
+      file_handler& operator=( const file_handler& );
+
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+  namespace detail {
+    /** @return true if the If-None-Match list v contains etag or "*", weak tags match too */
+    bool etag_matches( const fc::string& v, const fc::string& etag );
+
+    enum range_result { no_range, satisfiable, not_satisfiable };
+
+    /**
+     *  Parses a Range header with a single byte range of a body of size bytes, anything
+     *  else is ignored as RFC 7233 allows.
+     *  @param first, last the range, inclusive, if it is satisfiable
+     */
+    range_result parse_range( const fc::string& v, uint64_t size, uint64_t& first, uint64_t& last );
+  }
+
+} } // fc::http
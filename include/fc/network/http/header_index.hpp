@@ -0,0 +1,85 @@
+#pragma once
+#include <fc/io/iostream.hpp>
+#include <vector>
+
+namespace fc { namespace http {
+
+  /** header fields looked up by id instead of by name */
+  namespace header_id {
+    enum type {
+      unknown = 0,
+      host,
+      connection,
+      content_length,
+      content_type,
+      transfer_encoding,
+      accept_encoding,
+      content_encoding,
+      range,
+      if_none_match,
+      if_modified_since,
+      etag,
+      last_modified,
+      expect,
+      count
+    };
+
+    /** @return the id of a header field name, ignoring case */
+    type        lookup( const char* name, size_t len );
+    const char* name( type id );
+  }
+
+  /** compares header field names, ignoring ASCII case */
+  bool     iequals( const char* a, size_t alen, const char* b, size_t blen );
+  /** a hash of a header field name that ignores ASCII case */
+  uint32_t header_hash( const char* name, size_t len );
+
+  /**
+   *  Finds the header fields of a message by name without comparing every name.  The
+   *  index only keeps the position of each field, the names stay wherever the message
+   *  keeps them.  Well known fields are found by id in constant time, others by
+   *  comparing a case insensitive hash before the name.
+   */
+  class header_index
+  {
+    public:
+      static const uint32_t npos = uint32_t(-1);
+
+      header_index();
+
+      void            clear();
+      /** the number of fields added */
+      size_t          size()const { return _hashes.size(); }
+
+      /**
+       *  Adds the next field of the message, fields are numbered in the order they were added.
+       *  @return the id of its name
+       */
+      header_id::type add( const char* name, size_t len );
+
+      /** @return the number of the first field with the id, npos if there is none */
+      uint32_t        find( header_id::type id )const { return _known[id]; }
+
+      /**
+       *  @param name_of returns the name of a field given its number as a const_buffer
+       *  @return the number of the first field named name, npos if there is none
+       */
+      template<typename NameOf>
+      uint32_t        find( const char* name, size_t len, NameOf&& name_of )const {
+        header_id::type id = header_id::lookup( name, len );
+        if( id != header_id::unknown ) return _known[id];
+        uint32_t h = header_hash( name, len );
+        for( uint32_t i = 0; i < _hashes.size(); ++i ) {
+          if( _hashes[i] != h ) continue;
+          const_buffer n = name_of( i );
+          if( iequals( n.data, n.size, name, len ) ) return i;
+        }
+        return npos;
+      }
+
+    private:
+      uint32_t              _known[header_id::count];
+      std::vector<uint32_t> _hashes;
+  };
+
+} } // fc::http
@@ -0,0 +1,157 @@
+#pragma once
+#include <fc/string.hpp>
+#include <fc/io/iostream.hpp>
+#include <fc/network/http/header_index.hpp>
+#include <vector>
+
+namespace fc { namespace http {
+
+  /**
+   *  The read buffer of a connection.  Bytes are appended by fill() and consumed from
+   *  the front, anything received after the end of a message (a pipelined request)
+   *  stays buffered for the next one.
+   */
+  class read_buffer
+  {
+    public:
+      read_buffer( size_t initial_capacity = 8*1024 );
+
+      const char* data()const { return _buf.data() + _begin; }
+      size_t      size()const { return _end - _begin; }
+      void        consume( size_t n );
+      void        clear() { _begin = _end = 0; }
+
+      /**
+       *  Makes room for at least one more byte by moving the unconsumed bytes to the
+       *  front or by growing the buffer up to max_size.
+       *  @return the free space after the buffered bytes, see commit()
+       *  @throw parse_error_exception if size() already is max_size
+       */
+      mutable_buffer prepare( size_t max_size );
+      /** appends n bytes written to the space returned by prepare() */
+      void        commit( size_t n );
+
+      /**
+       *  Reads whatever s has available, at least one byte.
+       *  @return the number of bytes added
+       */
+      size_t      fill( istream& s, size_t max_size );
+
+      /** copies len bytes to out, taking buffered bytes first and reading the rest from s */
+      void        read( istream& s, char* out, size_t len );
+
+    private:
+      std::vector<char> _buf;
+      size_t            _begin;
+      size_t            _end;
+  };
+
+  /**
+   *  Incremental parser for the head of an HTTP/1.x message: the request or status line
+   *  and the header fields up to the empty line.  Nothing is copied, fields are kept as
+   *  offsets from the start of the message so the buffer holding it may be moved between
+   *  calls, and lines completed by an earlier call are not scanned again.
+   */
+  class head_parser
+  {
+    public:
+      enum message_type { request_head, response_head };
+
+      /** a range of the message, relative to its first byte */
+      struct field
+      {
+         field():offset(0),length(0){}
+         uint32_t offset;
+         uint32_t length;
+      };
+      struct header_field
+      {
+         field           key;
+         field           val; ///< without surrounding whitespace
+         header_id::type id;
+      };
+
+      /** how a head delimits the body of its message */
+      struct framing
+      {
+         framing():has_length(false),length(0),transfer_encoded(false),chunked(false){}
+         bool     has_length;
+         uint64_t length;
+         /** has a Transfer-Encoding, which overrides any Content-Length */
+         bool     transfer_encoded;
+         /** the last transfer coding is chunked, and the only chunked one */
+         bool     chunked;
+      };
+
+      head_parser( message_type t, size_t max_head_size = 64*1024, size_t max_headers = 100 );
+
+      /** prepares for the next message */
+      void   reset();
+
+      /**
+       *  @param data the first byte of the message, which must not change between calls
+       *  @param size the number of bytes of the message received so far
+       *  @return the length of the head once it is complete, 0 if more data is needed
+       *  @throw parse_error_exception if the head is malformed or too long
+       */
+      size_t parse( const char* data, size_t size );
+      bool   complete()const { return _complete; }
+
+      /// request line
+      /// @{
+      const field& method()const  { return _first; }
+      const field& target()const  { return _second; }
+      /// @}
+      /// status line
+      /// @{
+      int          status()const  { return _status; }
+      const field& reason()const  { return _third; }
+      /// @}
+      const field& version()const { return _type == request_head ? _third : _first; }
+
+      const std::vector<header_field>& headers()const { return _headers; }
+      /** @return the first field with the id, nullptr if there is none */
+      const header_field* find( header_id::type id )const {
+        uint32_t i = _index.find( id );
+        return i == header_index::npos ? nullptr : &_headers[i];
+      }
+      /** @return the first field named name ignoring case, nullptr if there is none */
+      const header_field* find( const char* data, const char* name, size_t len )const;
+      /** indexes headers() */
+      const header_index& index()const { return _index; }
+
+      /**
+       *  Looks at every Content-Length and Transfer-Encoding field of the complete head.
+       *  @param data the message given to parse()
+       *  @throw parse_error_exception if a Content-Length is invalid or they disagree, and
+       *         for a request whose body is not delimited unambiguously as RFC 7230 3.3.3
+       *         requires: a Transfer-Encoding whose last coding is not chunked, or one
+       *         together with a Content-Length
+       */
+      framing body_framing( const char* data )const;
+
+      static fc::string str( const char* data, const field& f ) {
+        return fc::string( data + f.offset, f.length );
+      }
+
+    private:
+      void parse_first_line( const char* line, size_t len );
+      void parse_header( const char* line, size_t len );
+      field make_field( const char* data, const char* b, const char* e )const;
+
+      message_type              _type;
+      size_t                    _max_head_size;
+      size_t                    _max_headers;
+      size_t                    _pos;        ///< start of the first unparsed line
+      const char*               _data;
+      bool                      _have_first;
+      bool                      _complete;
+      field                     _first;
+      field                     _second;
+      field                     _third;
+      int                       _status;
+      std::vector<header_field> _headers;
+      header_index              _index;
+  };
+
+} } // fc::http
@@ -0,0 +1,97 @@
+#pragma once
+#include <fc/network/http/server.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace fc { namespace http {
+
+  /**
+   *  Dispatches requests to handlers by method and path, e.g. from server::on_request:
+   *
+   *  @code
+   *    router r;
+   *    r.add( "GET", "/users/:id/posts/:post", ... );
+   *    r.add( "GET", "/static/" "*file", ... );
+   *    srv.on_request( [&]( const request& q, const server::response& s ) { r.dispatch( q, s ); } );
+   *  @endcode
+   *
+   *  The path templates are compiled into a radix trie, so finding the route of a path
+   *  takes time proportional to its length whatever the number of routes.  A ":name"
+   *  segment captures one segment of the path, a trailing "*name" captures the rest of
+   *  it.  Static segments are preferred over captures where both match.
+   *
+   *  Routes are added before the server starts, dispatch() may then be called from
+   *  several threads at once.
+   */
+  class router
+  {
+    public:
+      /** what a request captured from its path, and its query, decoded */
+      class params
+      {
+        public:
+          params();
+
+          /** @return the value of the path parameter name, or an empty string */
+          fc::string        get( const fc::string& name )const;
+          bool              has( const fc::string& name )const;
+          /** the captures in the order of the template */
+          const std::vector<header>& path_params()const { return _path; }
+
+          /** the part of the path after '?', as it was sent */
+          const fc::string& query_string()const { return _query; }
+          /** @return the value of the first query parameter named name, or an empty string */
+          fc::string        query( const fc::string& name )const;
+          /** the query is only parsed once a parameter is asked for */
+          const std::vector<header>& query_params()const;
+
+        private:
+          friend class router;
+          std::vector<header>          _path;
+          fc::string                   _query;
+          mutable bool                 _query_parsed;
+          mutable std::vector<header>  _query_params;
+      };
+
+      typedef std::function<void( const request&, const server::response&, const params& )> handler;
+
+      router();
+      ~router();
+
+      /**
+       *  @param method "*" matches any method, HEAD requests fall back on GET routes
+       *  @param path_template e.g. "/users/:id", ':' and '*' only start captures at the
+       *         start of a segment
+       *  @throw invalid_arg_exception if the template is malformed or its route
+       *         conflicts with another, i.e. has the same method or names a capture
+       *         at the same place differently
+       */
+      void add( const fc::string& method, const fc::string& path_template, const handler& h );
+
+      /**
+       *  Handles the requests no route matches, by default with 404, or 405 and an Allow
+       *  header if the path matches routes of other methods.
+       */
+      void set_not_found( const handler& h );
+
+      /** calls the handler of the route of r */
+      void dispatch( const request& r, const server::response& rep )const;
+
+      /**
+       *  @return the handler of the route of method and path, path without its query,
+       *          nullptr if there is none
+       *  @param p receives the path captures
+       */
+      const handler* find( const fc::string& method, const fc::string& path, params& p )const;
+
+    private:
+      // non copyable
+      router( const router& );
+      router& operator=( const router& );
+
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+} } // fc::http
@@ -1,10 +1,16 @@
 #pragma once 
 #include <fc/network/http/connection.hpp>
+#include <fc/network/tcp_server_pool.hpp>
+#include <fc/io/iostream.hpp>
+#include <fc/log/logger.hpp>
 #include <fc/shared_ptr.hpp>
 #include <functional>
 #include <memory>
 
-namespace fc { namespace http {
+namespace fc {
+  class path;
+
+namespace http {
 
   /**
    *  Listens on a given port for incomming http
@@ -37,9 +43,23 @@ namespace fc { namespace http {
 
           void add_header( const fc::string& key, const fc::string& val )const;
           void set_status( const http::reply::status_code& s )const;
+          /** 
+           *  Without a length the body is sent with the chunked transfer coding, or to an 
+           *  HTTP/1.0 client followed by closing the connection, and a zero length write()
+           *  ends it.
+           */
           void set_length( uint64_t s )const;
 
+          /** a response to a HEAD request only sends the head, the body is counted but dropped */
           void write( const char* data, uint64_t len )const;
+          /**
+           *  Sends length bytes of file, starting at offset, as the whole body without
+           *  copying them through user space where the platform allows.  Sets the length
+           *  of the response if it was not set.
+           */
+          void send_file( const fc::path& file, uint64_t offset, uint64_t length )const;
+          /** writes to the body through write(), close() ends a body without a length */
+          fc::ostream_ptr body_stream()const;
 
         private:
           fc::shared_ptr<impl> my;
@@ -48,7 +68,83 @@ namespace fc { namespace http {
       void listen( uint16_t p );
 
       /**
-       *  Set the callback to be called for every http request made.
+       *  How long a kept-alive connection may wait for the head of its next request
+       *  before it is closed, 30 seconds by default.
+       */
+      void set_idle_timeout( const microseconds& t );
+      /** 
+       *  Closes connections after they served n requests, 1000 by default, 0 for no limit.
+       *  The last response tells the client with Connection: close.
+       */
+      void set_max_requests_per_connection( uint32_t n );
+      /** the default of set_max_buffered_body() */
+      static const uint64_t default_max_buffered_body = 1024*1024;
+      /**
+       *  Request bodies up to n bytes long, default_max_buffered_body by default, are
+       *  read into request::body before the callback is called.  Longer bodies, and
+       *  chunked ones, are left to the callback to read from request::body_stream,
+       *  whatever it does not read is skipped.  With n = uint64_t(-1) every body is
+       *  buffered instead, and requests with bodies longer than 
+       *  body_istream::default_max_size are answered with 413 Payload Too Large.
+       */
+      void set_max_buffered_body( uint64_t n );
+      /**
+       *  Logs a line at info level for every response once its body has been written,
+       *  with the method, path, status, body size and duration.  A null logger, the
+       *  default, disables it.
+       */
+      void set_access_log( const fc::logger& log );
+      /**
+       *  Compresses response bodies of at least min_length bytes, or without a length,
+       *  with gzip or deflate if the client accepts either, at zlib level 0 to 9.  Only
+       *  compressible media types are, and responses that set Content-Encoding are left
+       *  alone, as are files sent with response::send_file.  A body written with a single
+       *  write() keeps a Content-Length, any other is sent like a body without a length.
+       *  The ETag of a compressed body gets the name of the coding appended, see
+       *  content_coding::tag().  By default, with min_length = uint64_t(-1), nothing is compressed.
+       */
+      void set_compression( uint64_t min_length, int level = 6 );
+
+      struct connection_stats
+      {
+         connection_stats():connections(0),active_connections(0),requests(0),reused_requests(0),idle_timeouts(0){}
+         uint64_t connections;        ///< accepted
+         uint64_t active_connections;
+         uint64_t requests;
+         uint64_t reused_requests;    ///< requests served on a connection that already served one
+         uint64_t idle_timeouts;      ///< connections closed by the idle timeout
+      };
+      /** the sum of the stats of every worker */
+      connection_stats get_connection_stats()const;
+
+      /**
+       *  Serves connections on n worker threads, handing each accepted connection to one
+       *  of them as m says.  The on_request callback runs on the worker that owns the
+       *  connection, so it may be called from several threads at once.  Connections are
+       *  accepted on the thread calling listen(), or on the workers in reuse_port mode.
+       *  By default, n = 0, everything runs on the thread calling listen().
+       *  @pre called before listen()
+       */
+      void set_worker_threads( uint32_t n, tcp_server_pool::accept_mode m = tcp_server_pool::round_robin );
+
+      struct worker_stats
+      {
+         worker_stats():index(0),total_latency_us(0),max_latency_us(0){}
+         uint32_t          index;
+         connection_stats  connections;
+         /** from reading the head of a request to writing the end of its response */
+         uint64_t          total_latency_us;
+         uint64_t          max_latency_us;
+      };
+      /** one entry per worker, a single one when there are no worker threads */
+      std::vector<worker_stats> get_worker_stats()const;
+
+      /**
+       *  Set the callback to be called for every http request made.  The next request
+       *  on the connection is read once the response body has been written completely,
+       *  which the callback may leave to another fiber holding a copy of the response.
+       *  Such a response must be finished with write(), with a zero length if it has
+       *  no body.
        */
       void on_request( const std::function<void(const http::request&, const server::response& s )>& cb );
 
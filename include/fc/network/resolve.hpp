@@ -4,5 +4,9 @@
 
 namespace fc
 {
+  /**
+   *  Resolves host through fc::asio::tcp::resolve(), results are cached and shared
+   *  between concurrent callers.
+   */
   std::vector<fc::ip::endpoint> resolve( const std::string& host, uint16_t port );
 }
@@ -0,0 +1,139 @@
+#pragma once
+#include <fc/time.hpp>
+#include <fc/string.hpp>
+#include <boost/atomic.hpp>
+
+namespace fc {
+  class variant;
+  class mutable_variant_object;
+
+  /**
+   *  I/O counters of a single socket, see enable_socket_stats().
+   */
+  struct socket_stats
+  {
+     socket_stats()
+     :bytes_read(0),bytes_written(0),reads(0),writes(0),async_reads(0),async_writes(0){}
+
+     uint64_t     bytes_read;
+     uint64_t     bytes_written;
+     uint64_t     reads;         ///< read calls that returned data
+     uint64_t     writes;
+     uint64_t     async_reads;   ///< reads that had to wait for the socket to become readable
+     uint64_t     async_writes;
+     microseconds read_wait;     ///< time spent inside read calls
+     microseconds write_wait;
+  };
+  void to_variant( const socket_stats& s, variant& v );
+
+  /**
+   *  Sockets created while enabled keep socket_stats and are listed by 
+   *  get_live_sockets().  Time is measured only while enabled.  Disabled by default,
+   *  sockets created meanwhile then only test a flag on every operation instead of 
+   *  counting it.  Meant to be set once at startup.
+   */
+  void enable_socket_stats( bool enable );
+  bool socket_stats_enabled();
+
+  /**
+   *  @return an array with an object for every registered socket that is still alive,
+   *          holding its type, endpoints and socket_stats
+   */
+  variant get_live_sockets();
+
+  namespace detail {
+    extern boost::atomic<bool> socket_stats_on;
+
+    /**
+     *  The counters of a socket, written by the threads using it and read by
+     *  get_live_sockets() on any other, so they are relaxed atomics.
+     */
+    struct socket_counters
+    {
+       socket_counters()
+       :bytes_read(0),bytes_written(0),reads(0),writes(0),async_reads(0),async_writes(0),
+        read_wait_us(0),write_wait_us(0){}
+
+       void count_read( uint64_t n ) {
+         bytes_read.fetch_add( n, boost::memory_order_relaxed );
+         reads.fetch_add( 1, boost::memory_order_relaxed );
+       }
+       void count_write( uint64_t n ) {
+         bytes_written.fetch_add( n, boost::memory_order_relaxed );
+         writes.fetch_add( 1, boost::memory_order_relaxed );
+       }
+       void count_wait( bool write, uint64_t n = 1 ) {
+         (write ? async_writes : async_reads).fetch_add( n, boost::memory_order_relaxed );
+       }
+       socket_stats snapshot()const;
+
+       boost::atomic<uint64_t> bytes_read;
+       boost::atomic<uint64_t> bytes_written;
+       boost::atomic<uint64_t> reads;
+       boost::atomic<uint64_t> writes;
+       boost::atomic<uint64_t> async_reads;
+       boost::atomic<uint64_t> async_writes;
+       boost::atomic<int64_t>  read_wait_us;
+       boost::atomic<int64_t>  write_wait_us;
+    };
+
+    /**
+     *  Base of the socket implementations that registers them while stats are enabled.
+     */
+    class socket_stats_source {
+      public:
+        socket_stats_source( const char* type );
+        virtual ~socket_stats_source();
+
+        /** 
+         *  Removes the socket from the registry, derived destructors call this first 
+         *  so it is never listed while partially destroyed.
+         */
+        void unregister_socket();
+
+        /** true if the socket is listed by get_live_sockets() */
+        bool is_registered()const { return registered; }
+
+        /// count into stats, only if the socket is registered as no one else reads them
+        /// @{
+        void count_read( uint64_t n )  { if( registered ) stats.count_read( n ); }
+        void count_write( uint64_t n ) { if( registered ) stats.count_write( n ); }
+        void count_wait( bool write, uint64_t n = 1 ) { if( registered ) stats.count_wait( write, n ); }
+        /// @}
+        /** 
+         *  Remembers the endpoints listed by get_live_sockets(), which cannot query a
+         *  socket owned by another thread.  Called once connected, bound or accepted.
+         */
+        void set_endpoints( const fc::string& local, const fc::string& remote );
+
+        const char*     type;
+        socket_counters stats;
+      private:
+        friend variant fc::get_live_sockets();
+        bool            registered;
+        /** guarded by the registry mutex */
+        fc::string      local;
+        fc::string      remote;
+    };
+
+    /** 
+     *  Adds the time until it goes out of scope to the read or write wait of s, if s is
+     *  registered and stats are enabled.
+     */
+    class io_timer {
+      public:
+        io_timer( socket_stats_source& s, bool write )
+        :_total( write ? s.stats.write_wait_us : s.stats.read_wait_us ),
+         _start( s.is_registered() && socket_stats_on.load( boost::memory_order_relaxed ) ? 
+                   time_point::now() : time_point() ){}
+        ~io_timer() {
+          if( _start != time_point() ) 
+            _total.fetch_add( (time_point::now() - _start).count(), boost::memory_order_relaxed );
+        }
+      private:
+        boost::atomic<int64_t>& _total;
+        time_point              _start;
+    };
+  }
+
+} // namespace fc
@@ -0,0 +1,61 @@
+#pragma once
+#include <fc/network/tcp_socket.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace fc {
+  class thread;
+
+  /**
+   *  Accepts connections on a port and runs each of them on one of a fixed set of
+   *  worker threads, so that neither accepting nor per-connection work is pinned
+   *  to a single core.
+   */
+  class tcp_server_pool
+  {
+    public:
+      enum accept_mode {
+        reuse_port,   ///< every worker runs its own SO_REUSEPORT listener, the kernel balances
+        round_robin,  ///< one listener on the calling thread hands sockets to workers in turn
+        least_loaded  ///< one listener hands each socket to the worker with the fewest open connections
+      };
+
+      struct worker_stats
+      {
+         worker_stats():index(0),accepted(0),active(0){}
+         uint32_t index;
+         uint64_t accepted; ///< connections given to this worker
+         uint64_t active;   ///< connections whose handler has not returned yet
+      };
+
+      /**
+       *  Called in a new fiber on the worker thread that owns the connection, the
+       *  socket is closed when it returns.
+       */
+      typedef std::function<void(const tcp_socket_ptr&)> connection_handler;
+
+      tcp_server_pool( uint32_t num_workers, accept_mode m = round_robin );
+      ~tcp_server_pool();
+
+      /** @pre called before listen() */
+      void on_connection( const connection_handler& h );
+      void listen( uint16_t port, uint32_t backlog = 0 );
+      /** stops accepting, connections that are already open are left to finish */
+      void close();
+
+      uint32_t     num_workers()const;
+      /** allows a worker to be configured, e.g. to enable its io reactor, before listen() */
+      fc::thread&  worker( uint32_t i );
+      std::vector<worker_stats> get_worker_stats()const;
+
+    private:
+      // non copyable
+      tcp_server_pool( const tcp_server_pool& );
+      tcp_server_pool& operator=( const tcp_server_pool& );
+
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+} // namespace fc
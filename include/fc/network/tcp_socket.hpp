@@ -2,9 +2,12 @@
 #include <fc/utility.hpp>
 #include <fc/fwd.hpp>
 #include <fc/io/iostream.hpp>
+#include <fc/time.hpp>
+#include <functional>
 
 namespace fc {
   namespace ip { class endpoint; } 
+  class path;
   class tcp_socket : public virtual iostream 
   {
     public:
@@ -12,31 +15,109 @@ namespace fc {
       ~tcp_socket();
 
       void     connect_to( const fc::ip::endpoint& e );
+      /**
+       *  @throw timeout_exception if not connected within timeout, the socket must be
+       *         closed before it can connect again
+       */
+      void     connect_to( const fc::ip::endpoint& e, const microseconds& timeout );
       fc::ip::endpoint remote_endpoint()const;
 
+      /**
+       *  Like readsome() but gives up at deadline.  The socket stays open and no data is
+       *  lost, so the read can simply be retried.  Without an io reactor the pending read
+       *  is canceled through asio, which also aborts a write waiting on this socket.
+       *  @throw timeout_exception
+       */
+      size_t   readsome_until( char* buffer, size_t max, const time_point& deadline );
+
       /// istream interface
       /// @{
       virtual size_t   readsome( char* buffer, size_t max );
+      virtual size_t   readvsome( const mutable_buffer* bufs, size_t count );
       virtual bool     eof()const;
       /// @}
 
       /// ostream interface
       /// @{
       virtual size_t   writesome( const char* buffer, size_t len );
+      virtual size_t   writevsome( const const_buffer* bufs, size_t count );
+      /** sends all buffers with a single gather write */
+      virtual ostream& writev( const const_buffer* bufs, size_t count );
       virtual void     flush();
       virtual void     close();
       /// @}
 
       bool   is_open()const;
 
+      /** the underlying socket descriptor, e.g. to pass it to another process */
+      int    native_handle();
+      /** 
+       *  Takes ownership of an already connected socket descriptor, closing the 
+       *  current connection if there is one.
+       */
+      void   assign( int fd );
+      /**
+       *  Closes this descriptor without shutting the connection down, which goes on
+       *  through the copies passed elsewhere, e.g. by unix_socket::send_socket().
+       *  @pre no read or write is in progress
+       */
+      void   detach();
+
+      /**
+       *  Sends length bytes of file starting at offset, or up to the end of the file,
+       *  without copying them through user space (sendfile) where supported.
+       *  @return the number of bytes sent
+       */
+      uint64_t send_file( const fc::path& file, uint64_t offset = 0, uint64_t length = uint64_t(-1) );
+
+      /**
+       *  Moves up to length bytes from the pipe fd into this socket with splice(2),
+       *  stopping early when the write end of the pipe is closed.
+       *  @param wait_readable cooperatively waits until fd has data
+       *  @return the number of bytes moved
+       */
+      uint64_t splice_from( int fd, uint64_t length, const std::function<void()>& wait_readable );
+      /**
+       *  Moves up to length bytes from this socket into the pipe fd with splice(2),
+       *  stopping early at the end of the stream.
+       *  @param wait_writable cooperatively waits until fd has room
+       */
+      uint64_t splice_to( int fd, uint64_t length, const std::function<void()>& wait_writable );
+
+      /// socket options, only valid while the socket is open
+      /// @{
+      /** disables Nagle's algorithm so small writes are sent immediately */
+      void   set_no_delay( bool );
+      void   set_send_buffer_size( size_t s );
+      void   set_receive_buffer_size( size_t s );
+      /**
+       *  Enables TCP keepalive probes.  A zero idle, interval or probe count keeps the
+       *  system default, these are ignored on platforms that cannot set them per socket.
+       *  Times are rounded up to whole seconds.
+       */
+      void   set_keep_alive( bool enable, const microseconds& idle = microseconds(), 
+                             const microseconds& interval = microseconds(), uint32_t probes = 0 );
+      /** 
+       *  Sends ACKs immediately rather than delaying them.  The kernel may fall back to
+       *  delayed ACKs later, so latency sensitive protocols set this after each read.
+       *  Ignored on platforms without TCP_QUICKACK.
+       */
+      void   set_quick_ack( bool );
+      /// @}
+
     private:
       friend class tcp_server;
       class impl;
-      fc::fwd<impl,0x44> my;
+      fc::fwd<impl,0x128> my;
   };
   typedef std::shared_ptr<tcp_socket> tcp_socket_ptr;
 
   
+  /**
+   *  Each server accepts on one reactor, taken in turn like those of the sockets, so a
+   *  single listener accepts on a single reactor thread.  Accepts are spread over
+   *  several reactors by listening with several servers in reuse_port mode.
+   */
   class tcp_server 
   {
     public:
@@ -45,7 +126,28 @@ namespace fc {
 
       void close();
       bool accept( tcp_socket& s );
-      void listen( uint16_t port );
+      /**
+       *  Like accept() but gives up at deadline, the server keeps listening.
+       *  @throw timeout_exception
+       */
+      bool accept_until( tcp_socket& s, const time_point& deadline );
+      /**
+       *  @param backlog the length of the pending connection queue, 0 uses the
+       *                 system maximum
+       */
+      void listen( uint16_t port, uint32_t backlog = 0 );
+
+      /// options applied by listen(), they must be set before it is called
+      /// @{
+      /** enabled by default */
+      void set_reuse_address( bool enable = true );
+      /** 
+       *  Allows several listeners, in this or other processes, to bind the same port
+       *  with the kernel spreading new connections across them.
+       *  @throw if SO_REUSEPORT is not supported on this platform
+       */
+      void set_reuse_port( bool enable = true );
+      /// @}
     
     private:
       // non copyable
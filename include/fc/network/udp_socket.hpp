@@ -1,12 +1,9 @@
 #pragma once
 #include <fc/utility.hpp>
 #include <fc/shared_ptr.hpp>
+#include <fc/network/ip.hpp>
 
 namespace fc {
-  namespace ip {
-    class endpoint;
-    class address;
-  }
 
   /**
    *  The udp_socket class has reference semantics, all copies will
@@ -14,6 +11,23 @@ namespace fc {
    */
   class udp_socket {
     public:
+      /** one entry of a receive_many() or send_many() batch */
+      struct datagram {
+        datagram():data(nullptr),size(0),received(0),segment_size(0){}
+        datagram( char* d, size_t s ):data(d),size(s),received(0),segment_size(0){}
+
+        char*            data;     ///< caller provided buffer
+        size_t           size;     ///< capacity when receiving, bytes to send when sending
+        size_t           received; ///< bytes received
+        fc::ip::endpoint endpoint; ///< sender when receiving, destination when sending
+        /**
+         *  When sending, splits data into datagrams of this size with a single send
+         *  (UDP GSO).  When receiving with set_gro(true), the size of each datagram
+         *  coalesced into data.  0 means data holds a single datagram.
+         */
+        uint16_t         segment_size;
+      };
+
       udp_socket();
       udp_socket( const udp_socket& s );
       ~udp_socket();
@@ -23,6 +37,31 @@ namespace fc {
       void   bind( const fc::ip::endpoint& );
       size_t receive_from( char* b, size_t l, fc::ip::endpoint& from );
       size_t send_to( const char* b, size_t l, const fc::ip::endpoint& to ); 
+
+      /**
+       *  Receives up to count datagrams with a single system call where supported,
+       *  cooperatively blocking until at least one is available.  Only one fiber at a
+       *  time may wait in receive_many() on a socket and its copies.
+       *  @return the number of entries of d that were filled in
+       *  @throw assert_exception if another fiber is waiting in receive_many()
+       */
+      size_t receive_many( datagram* d, size_t count );
+      /**
+       *  Sends every datagram, batching them into as few system calls as possible.
+       *  An unset endpoint uses the address given to connect().  Only one fiber at a
+       *  time may wait in send_many() on a socket and its copies.
+       *  @return count
+       *  @throw assert_exception if another fiber is waiting in send_many()
+       */
+      size_t send_many( const datagram* d, size_t count );
+      /**
+       *  Lets the kernel coalesce datagrams from the same sender (UDP GRO), see 
+       *  datagram::segment_size.
+       *  @return false if the platform does not support it
+       */
+      bool   set_gro( bool enable );
+
+      /** fibers waiting in receive_many() or send_many() are woken up with canceled_exception */
       void   close();
 
       void   set_multicast_enable_loopback( bool );
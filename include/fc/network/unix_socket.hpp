@@ -0,0 +1,92 @@
+#pragma once
+#include <fc/utility.hpp>
+#include <fc/io/iostream.hpp>
+#include <memory>
+
+namespace fc {
+  class path;
+  class tcp_socket;
+
+  /**
+   *  A stream over a unix domain socket, for RPC between processes on the same
+   *  host without going through the TCP stack.  It can also pass open file
+   *  descriptors, and with them accepted tcp connections, to the peer process.
+   */
+  class unix_socket : public virtual iostream
+  {
+    public:
+      unix_socket();
+      ~unix_socket();
+
+      void     connect_to( const fc::path& p );
+
+      /// istream interface
+      /// @{
+      virtual size_t   readsome( char* buffer, size_t max );
+      virtual size_t   readvsome( const mutable_buffer* bufs, size_t count );
+      virtual bool     eof()const;
+      /// @}
+
+      /// ostream interface
+      /// @{
+      virtual size_t   writesome( const char* buffer, size_t len );
+      virtual size_t   writevsome( const const_buffer* bufs, size_t count );
+      virtual ostream& writev( const const_buffer* bufs, size_t count );
+      virtual void     flush();
+      virtual void     close();
+      /// @}
+
+      bool   is_open()const;
+
+      /**
+       *  Sends a duplicate of fd to the peer along with a single byte of stream data.
+       *  The caller keeps ownership of fd.
+       */
+      void   send_fd( int fd );
+      /**
+       *  Reads the byte written by the peer's send_fd() and returns the descriptor
+       *  that came with it, owned by the caller.
+       *  @throw if the byte carried no descriptor
+       */
+      int    receive_fd();
+
+      /** 
+       *  Passes an open connection to the peer, s is closed afterwards without
+       *  shutting the connection down.
+       */
+      void   send_socket( tcp_socket& s );
+      /** @post s is the connection passed by the peer's send_socket() */
+      void   receive_socket( tcp_socket& s );
+
+    private:
+      friend class unix_server;
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+  typedef std::shared_ptr<unix_socket> unix_socket_ptr;
+
+  class unix_server
+  {
+    public:
+      unix_server();
+      ~unix_server();
+
+      void close();
+      bool accept( unix_socket& s );
+      /**
+       *  Binds p.  A socket file left at p by a previous process, which refuses
+       *  connections, is removed.  The file is removed again by close().
+       *  @throw if p is something else or a server still listens on it
+       */
+      void listen( const fc::path& p );
+
+    private:
+      // non copyable
+      unix_server( const unix_server& );
+      unix_server& operator=( const unix_server& s );
+
+      class impl;
+      std::unique_ptr<impl> my;
+  };
+
+} // namespace fc
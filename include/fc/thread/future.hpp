@@ -67,6 +67,12 @@ namespace fc {
       void _set_value(const void* v);
 
       void _on_complete( detail::completion_handler* c );
+      /**
+       *  Returns a ready promise to its initial state so it can be reused for
+       *  another operation.
+       *  @pre no fiber is waiting on this promise
+       */
+      void _reset();
       ~promise_base();
 
     private:
@@ -2,6 +2,7 @@
 #include <fc/thread/task.hpp>
 #include <fc/vector.hpp>
 #include <fc/string.hpp>
+#include <memory>
 
 namespace fc {
   class time_point;
@@ -62,6 +63,84 @@ namespace fc {
          return r;
       }
       void poke();
+
+      /**
+       *  How fibers on this thread wait for I/O.
+       */
+      enum io_engine {
+        asio_engine,  ///< completions are delivered by the fc::asio threads
+        epoll_engine, ///< this thread polls its own descriptors, see enable_io_reactor()
+        uring_engine  ///< as epoll_engine, and reads/writes are batched through io_uring
+      };
+
+      /**
+       *  @brief lets this thread wait for socket readiness itself
+       *
+       *  When enabled the thread sleeps in epoll rather than on a condition
+       *  variable whenever it has no ready tasks, and fibers blocked in wait_io()
+       *  are resumed directly by this thread without any cross thread wakeups.
+       *  Sockets used from a thread with a reactor perform their I/O on it.
+       *
+       *  The engine requested by the FC_IO_ENGINE environment variable ("asio", "epoll"
+       *  or "uring") is used, uring falls back to epoll if the kernel does not support it.
+       *
+       *  @note must be called from this thread before other threads post to it.
+       *  @return false if the platform does not support it.
+       */
+      bool enable_io_reactor();
+      bool enable_io_reactor( io_engine e );
+      bool has_io_reactor()const;
+      io_engine get_io_engine()const;
+
+      /**
+       *  Blocks the current fiber until fd is readable (or writable if @param write).
+       *  @pre is_current() && has_io_reactor()
+       *  @throw timeout_exception, canceled_exception if cancel_io() is called
+       */
+      void wait_io( int fd, bool write, const time_point& timeout = time_point::maximum() );
+
+      /**
+       *  Cancels any wait_io() for fd, must be called before fd is closed.  If this
+       *  is not the current thread it blocks until the waiters have been canceled.
+       */
+      void cancel_io( int fd );
+
+      /**
+       *  Refers to the io reactor of a thread without keeping either alive, for objects
+       *  such as sockets that may be closed after the thread they waited on has exited.
+       */
+      class reactor_ref;
+      typedef std::shared_ptr<reactor_ref> reactor_ptr;
+      /** @return null if this thread has no io reactor */
+      reactor_ptr get_io_reactor()const;
+      /**
+       *  Like cancel_io() on the thread of r, but does nothing once its reactor has shut
+       *  down, the waiters were then canceled when the thread quit.
+       */
+      static void cancel_io( const reactor_ptr& r, int fd );
+
+      /**
+       *  Reads through this thread's io_uring.  The calling fiber blocks until the
+       *  read completes while other fibers keep running, and all reads and writes
+       *  queued in the meantime are handed to the kernel with a single system call
+       *  once the thread runs out of ready fibers.  Reads into a buffer registered
+       *  with register_io_buffers() use IORING_OP_READ_FIXED.
+       *
+       *  @param offset the file offset, or -1 for the current position / a stream
+       *  @pre is_current() && get_io_engine() == uring_engine
+       *  @return the number of bytes read, 0 at end of file
+       */
+      size_t uring_read( int fd, char* buf, size_t len, int64_t offset = -1 );
+      size_t uring_write( int fd, const char* buf, size_t len, int64_t offset = -1 );
+      /** like uring_write() but for sockets, never raises SIGPIPE */
+      size_t uring_send( int fd, const char* buf, size_t len );
+
+      /**
+       *  Registers buffers with the kernel so reads into them do not need to map
+       *  the pages for every request, replaces any previously registered buffers.
+       *  @pre get_io_engine() == uring_engine
+       */
+      bool   register_io_buffers( const std::vector< std::pair<char*,size_t> >& bufs );
      
      
       /**
@@ -1,12 +1,31 @@
 #include <fc/asio.hpp>
 #include <fc/thread/thread.hpp>
 #include <boost/thread.hpp>
+#include <boost/atomic.hpp>
 #include <fc/log/logger.hpp>
+#include <cstdlib>
+#include <unordered_map>
 
 namespace fc {
   namespace asio {
     namespace detail {
+        /**
+         *  Each reactor thread stores its own reactor here so completion handlers
+         *  can be counted without a lookup.
+         */
+        struct reactor;
+        reactor*& current_reactor() {
+           #ifdef _MSC_VER
+              static __declspec(thread) reactor* r = NULL;
+           #else
+              static __thread reactor* r = NULL;
+           #endif
+           return r;
+        }
+        void record_completion();
+
         void read_write_handler( const promise<size_t>::ptr& p, const boost::system::error_code& ec, size_t bytes_transferred ) {
+            record_completion();
             if( !ec ) p->set_value(bytes_transferred);
             else {
             //   elog( "%s", boost::system::system_error(ec).what() );
@@ -30,11 +49,13 @@ namespace fc {
             }
         }
         void read_write_handler_ec( promise<size_t>* p, boost::system::error_code* oec, const boost::system::error_code& ec, size_t bytes_transferred ) {
+            record_completion();
             p->set_value(bytes_transferred);
             *oec = ec;
         }
         void error_handler( const promise<void>::ptr& p, 
                               const boost::system::error_code& ec ) {
+            record_completion();
             if( !ec ) p->set_value();
             else
             {
@@ -57,8 +78,19 @@ namespace fc {
             }
         }
 
+        void throw_error( const boost::system::error_code& ec ) {
+            if( ec == boost::asio::error::operation_aborted )
+               FC_THROW_EXCEPTION( canceled_exception, "${message}", ("message", ec.message()) );
+            if( ec == boost::asio::error::eof )
+               FC_THROW_EXCEPTION( eof_exception, "${message}", ("message", ec.message()) );
+            if( ec == boost::asio::error::timed_out )
+               FC_THROW_EXCEPTION( timeout_exception, "${message}", ("message", ec.message()) );
+            FC_THROW_EXCEPTION( exception, "${message}", ("message", ec.message()) );
+        }
+
         void error_handler_ec( promise<boost::system::error_code>* p, 
                               const boost::system::error_code& ec ) {
+            record_completion();
             p->set_value(ec);
         }
 
@@ -77,39 +109,268 @@ namespace fc {
             } else {
                 //elog( "%s", boost::system::system_error(ec).what() );
                 //p->set_exception( fc::copy_exception( boost::system::system_error(ec) ) );
-                p->set_exception( 
-                    fc::exception_ptr( new fc::exception( 
-                        FC_LOG_MESSAGE( error, "process exited with: ${message} ", 
-                                        ("message", boost::system::system_error(ec).what())) ) ) );
+                if( ec == boost::asio::error::operation_aborted )
+                  p->set_exception( fc::exception_ptr( new fc::canceled_exception( 
+                          FC_LOG_MESSAGE( error, "${message} ", ("message", boost::system::system_error(ec).what())) ) ) );
+                else if( ec == boost::asio::error::timed_out || ec == boost::asio::error::host_not_found_try_again )
+                  p->set_exception( fc::exception_ptr( new fc::timeout_exception( 
+                          FC_LOG_MESSAGE( error, "${message} ", ("message", boost::system::system_error(ec).what())) ) ) );
+                else
+                  p->set_exception( 
+                      fc::exception_ptr( new fc::exception( 
+                          FC_LOG_MESSAGE( error, "process exited with: ${message} ", 
+                                          ("message", boost::system::system_error(ec).what())) ) ) );
             }
         }
     }
-    boost::asio::io_service& default_io_service(bool cleanup) {
-        static boost::asio::io_service       io;
-        static boost::asio::io_service::work the_work(io);
-        static boost::thread                 io_t([=] 
-               { 
-                 try { 
-                   fc::thread::current().set_name("asio");  
-                   io.run(); 
-                 }
-                 catch(...)
-                 {
-                   elog( "unexpected asio exception" );
+    namespace detail {
+        struct reactor {
+           reactor( uint32_t i )
+           :index(i),work(io),assigned(0),completions(0){}
+
+           void run() {
+             try { 
+               current_reactor() = this;
+               fc::thread::current().set_name( index ? "asio" + fc::to_string(uint64_t(index)) : "asio" );
+               io.run(); 
+             }
+             catch(...)
+             {
+               elog( "unexpected asio exception" );
+             }
+           }
+
+           uint32_t                       index;
+           boost::asio::io_service        io;
+           boost::asio::io_service::work  work;
+           boost::atomic<uint64_t>        assigned;
+           boost::atomic<uint64_t>        completions;
+           std::unique_ptr<boost::thread> thread;
+        };
+
+        void record_completion() {
+           reactor* r = current_reactor();
+           if( r ) r->completions.fetch_add( 1, boost::memory_order_relaxed );
+        }
+
+        boost::atomic<uint32_t>& requested_io_threads() {
+           static boost::atomic<uint32_t> n(0);
+           return n;
+        }
+
+        class reactor_pool {
+           public:
+              reactor_pool( uint32_t n ):next(0) {
+                 reactors.reserve(n);
+                 for( uint32_t i = 0; i < n; ++i ) {
+                    reactors.push_back( std::unique_ptr<reactor>( new reactor(i) ) );
+                    reactor* r = reactors.back().get();
+                    r->thread.reset( new boost::thread( [=](){ r->run(); } ) );
                  }
-               } 
-               );
+              }
+
+              reactor& next_reactor() {
+                 reactor& r = *reactors[ next.fetch_add( 1, boost::memory_order_relaxed ) % reactors.size() ];
+                 r.assigned.fetch_add( 1, boost::memory_order_relaxed );
+                 return r;
+              }
+
+              std::vector<std::unique_ptr<reactor> > reactors;
+              boost::atomic<uint32_t>                next;
+        };
+
+        reactor_pool& get_reactor_pool() {
+           // intentionally leaked, handlers may still be running during static destruction
+           static reactor_pool* pool = nullptr;
+           static boost::once_flag init = BOOST_ONCE_INIT;
+           boost::call_once( init, [](){
+              uint32_t n = requested_io_threads().load();
+              if( n == 0 ) {
+                 const char* env = std::getenv( "FC_ASIO_THREADS" );
+                 if( env ) n = uint32_t( std::atoi(env) );
+              }
+              pool = new reactor_pool( n ? n : 1 );
+           } );
+           return *pool;
+        }
+    }
+
+    boost::asio::io_service& default_io_service(bool cleanup) {
+        return detail::get_reactor_pool().reactors.front()->io;
+    }
+
+    void set_num_io_threads( uint32_t n ) {
+        detail::requested_io_threads().store(n);
+    }
 
-        return io;
+    boost::asio::io_service& next_io_service() {
+        return detail::get_reactor_pool().next_reactor().io;
+    }
+
+    std::vector<reactor_stats> get_reactor_stats() {
+        detail::reactor_pool& pool = detail::get_reactor_pool();
+        std::vector<reactor_stats> stats( pool.reactors.size() );
+        for( uint32_t i = 0; i < stats.size(); ++i ) {
+           stats[i].index       = i;
+           stats[i].assigned    = pool.reactors[i]->assigned.load( boost::memory_order_relaxed );
+           stats[i].completions = pool.reactors[i]->completions.load( boost::memory_order_relaxed );
+        }
+        return stats;
     }
 
     namespace tcp {
+        namespace detail {
+            typedef promise<std::vector<endpoint> > resolve_promise;
+
+            struct resolve_entry {
+               resolve_entry():pending(false){}
+               bool                                 pending;
+               fc::time_point                       expires;
+               std::vector<endpoint>                eps;
+               fc::exception_ptr                    error;
+               std::vector<resolve_promise::ptr>    waiters; ///< callers sharing the pending lookup
+            };
+
+            struct resolve_cache {
+               resolve_cache()
+               :ttl(fc::seconds(60)),negative_ttl(fc::seconds(5)),hits(0),misses(0),shared(0){}
+
+               /** drops expired entries once the cache has grown */
+               void prune( const fc::time_point& now ) {
+                  if( entries.size() < 1024 ) return;
+                  for( auto itr = entries.begin(); itr != entries.end(); ) {
+                     if( !itr->second.pending && itr->second.expires <= now ) itr = entries.erase(itr);
+                     else ++itr;
+                  }
+               }
+
+               boost::mutex                                  mutex;
+               std::unordered_map<std::string,resolve_entry> entries;
+               fc::microseconds                              ttl;
+               fc::microseconds                              negative_ttl;
+               uint64_t                                      hits;
+               uint64_t                                      misses;
+               uint64_t                                      shared;
+            };
+
+            resolve_cache& get_resolve_cache() {
+               // intentionally leaked like the reactor pool
+               static resolve_cache* cache = new resolve_cache();
+               return *cache;
+            }
+
+            std::vector<endpoint> uncached_resolve( const std::string& hostname, const std::string& port ) {
+               resolver res( fc::asio::default_io_service() );
+               resolve_promise::ptr p( new resolve_promise("fc::asio::tcp::resolve") );
+               res.async_resolve( boost::asio::ip::tcp::resolver::query(hostname,port), 
+                                boost::bind( fc::asio::detail::resolve_handler<endpoint,resolver_iterator>, p, _1, _2 ) );
+               return p->wait();
+            }
+        }
+
         std::vector<boost::asio::ip::tcp::endpoint> resolve( const std::string& hostname, const std::string& port) {
-            resolver res( fc::asio::default_io_service() );
-            promise<std::vector<boost::asio::ip::tcp::endpoint> >::ptr p( new promise<std::vector<boost::asio::ip::tcp::endpoint> >() );
-            res.async_resolve( boost::asio::ip::tcp::resolver::query(hostname,port), 
-                             boost::bind( detail::resolve_handler<boost::asio::ip::tcp::endpoint,resolver_iterator>, p, _1, _2 ) );
-            return p->wait();;
+            detail::resolve_cache& c = detail::get_resolve_cache();
+            std::string key = hostname + ":" + port;
+            detail::resolve_promise::ptr wait_for;
+            {
+               boost::unique_lock<boost::mutex> lock( c.mutex );
+               detail::resolve_entry& e = c.entries[key];
+               if( e.pending ) {
+                  ++c.shared;
+                  wait_for.reset( new detail::resolve_promise("fc::asio::tcp::resolve") );
+                  e.waiters.push_back( wait_for );
+               } else if( e.expires > fc::time_point::now() ) {
+                  ++c.hits;
+                  if( e.error ) {
+                     fc::exception_ptr err = e.error;
+                     lock.unlock();
+                     err->dynamic_rethrow_exception();
+                  }
+                  return e.eps;
+               } else {
+                  ++c.misses;
+                  e.pending = true;
+               }
+            }
+            if( wait_for ) {
+               try {
+                  return wait_for->wait();
+               } catch ( const fc::canceled_exception& ) {
+                  // the fiber running the lookup was canceled rather than this one
+                  if( !wait_for->ready() ) throw;
+               }
+               return resolve( hostname, port );
+            }
+
+            std::vector<endpoint> eps;
+            fc::exception_ptr     err;
+            bool                  transient = false;
+            try {
+               eps = detail::uncached_resolve( hostname, port );
+            } catch ( const fc::canceled_exception& ex ) {
+               err = ex.dynamic_copy_exception();
+               transient = true;
+            } catch ( const fc::timeout_exception& ex ) {
+               err = ex.dynamic_copy_exception();
+               transient = true;
+            } catch ( const fc::exception& ex ) {
+               err = ex.dynamic_copy_exception();
+            } catch ( const std::exception& ex ) {
+               err = fc::exception_ptr( new fc::exception( 
+                        FC_LOG_MESSAGE( error, "${message}", ("message", fc::string(ex.what())) ) ) );
+            }
+
+            std::vector<detail::resolve_promise::ptr> waiters;
+            {
+               boost::unique_lock<boost::mutex> lock( c.mutex );
+               fc::time_point now = fc::time_point::now();
+               auto itr = c.entries.find( key );
+               fc_swap( waiters, itr->second.waiters );
+               fc::microseconds ttl = err ? c.negative_ttl : c.ttl;
+               if( transient || ttl.count() <= 0 ) {
+                  c.entries.erase( itr );
+               } else {
+                  detail::resolve_entry& e = itr->second;
+                  e.pending = false;
+                  e.eps     = eps;
+                  e.error   = err;
+                  e.expires = now + ttl;
+               }
+               c.prune( now );
+            }
+            for( auto itr = waiters.begin(); itr != waiters.end(); ++itr ) {
+               if( err ) (*itr)->set_exception( err );
+               else      (*itr)->set_value( eps );
+            }
+            if( err ) err->dynamic_rethrow_exception();
+            return eps;
+        }
+
+        void set_resolve_cache_ttl( const microseconds& ttl, const microseconds& negative_ttl ) {
+            detail::resolve_cache& c = detail::get_resolve_cache();
+            boost::unique_lock<boost::mutex> lock( c.mutex );
+            c.ttl          = ttl;
+            c.negative_ttl = negative_ttl;
+        }
+
+        void clear_resolve_cache() {
+            detail::resolve_cache& c = detail::get_resolve_cache();
+            boost::unique_lock<boost::mutex> lock( c.mutex );
+            for( auto itr = c.entries.begin(); itr != c.entries.end(); ) {
+               if( itr->second.pending ) ++itr;
+               else itr = c.entries.erase(itr);
+            }
+        }
+
+        resolve_cache_stats get_resolve_cache_stats() {
+            detail::resolve_cache& c = detail::get_resolve_cache();
+            boost::unique_lock<boost::mutex> lock( c.mutex );
+            resolve_cache_stats s;
+            s.hits    = c.hits;
+            s.misses  = c.misses;
+            s.shared  = c.shared;
+            s.entries = c.entries.size();
+            return s;
         }
     }
     namespace udp {
@@ -2,6 +2,7 @@
 #include <fc/io/iostream.hpp>
 #include <fc/io/buffered_iostream.hpp>
 #include <fc/asio.hpp>
+#include <fc/network/tcp_socket.hpp>
 #include <fc/filesystem.hpp>
 #include <fc/log/logger.hpp>
 #include <boost/process/all.hpp>
@@ -107,15 +108,15 @@ iprocess& process::exec( const fc::path& exe,
 
   if( opt & open_stdout ) {
      bp::handle outh = my->child->get_handle( bp::stdout_id );
-     my->_outp.reset( new bp::pipe( fc::asio::default_io_service(), outh.release() ) );
+     my->_outp.reset( new bp::pipe( fc::asio::next_io_service(), outh.release() ) );
   }
   if( opt & open_stderr ) {
      bp::handle errh = my->child->get_handle( bp::stderr_id );
-     my->_errp.reset( new bp::pipe( fc::asio::default_io_service(), errh.release() ) );
+     my->_errp.reset( new bp::pipe( fc::asio::next_io_service(), errh.release() ) );
   }
   if( opt & open_stdin ) {
      bp::handle inh  = my->child->get_handle( bp::stdin_id );
-     my->_inp.reset(  new bp::pipe( fc::asio::default_io_service(), inh.release()  ) );
+     my->_inp.reset(  new bp::pipe( fc::asio::next_io_service(), inh.release()  ) );
   }
 
 
@@ -179,6 +180,28 @@ fc::buffered_istream_ptr process::err_stream() {
   return my->_err;
 }
 
+uint64_t process::copy_out_to( tcp_socket& s, uint64_t length ) {
+  #ifdef BOOST_POSIX_API
+  std::shared_ptr<bp::pipe> p = my->_outp;
+  FC_ASSERT( p, "stdout of the process is not open" );
+  fc::asio::completion_slot slot( "process::copy_out_to" );
+  return s.splice_from( p->native_handle(), length, [&](){ fc::asio::wait_readable( *p, slot ); } );
+  #else
+  FC_THROW_EXCEPTION( exception, "splice is not supported on this platform" );
+  #endif
+}
+
+uint64_t process::copy_in_from( tcp_socket& s, uint64_t length ) {
+  #ifdef BOOST_POSIX_API
+  std::shared_ptr<bp::pipe> p = my->_inp;
+  FC_ASSERT( p, "stdin of the process is not open" );
+  fc::asio::completion_slot slot( "process::copy_in_from" );
+  return s.splice_to( p->native_handle(), length, [&](){ fc::asio::wait_writable( *p, slot ); } );
+  #else
+  FC_THROW_EXCEPTION( exception, "splice is not supported on this platform" );
+  #endif
+}
+
 int process::result() 
 {
     return my->_exited.wait();
@@ -2,10 +2,171 @@
 #include <fc/filesystem.hpp>
 #include <fstream>
 #include <fc/exception/exception.hpp>
+#include <fc/thread/thread.hpp>
 #include <fc/log/logger.hpp>
 
+#if defined(__linux__)
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <errno.h>
+  #include <string.h>
+  #include <sys/stat.h>
+  #define FC_FSTREAM_FD 1
+#endif
+
 
 namespace fc {
+#ifdef FC_FSTREAM_FD
+   /**
+    *  Files opened by a thread with an io_uring are accessed with pread/pwrite at a
+    *  tracked offset, through the ring when the calling thread has one so that a fiber
+    *  waiting on the disk does not block the whole thread.  Any other file is left to
+    *  std::fstream.
+    */
+   namespace detail {
+      size_t file_read( int fd, char* buf, size_t len, uint64_t pos ) {
+         fc::thread& t = fc::thread::current();
+         if( t.get_io_engine() == fc::thread::uring_engine )
+            return t.uring_read( fd, buf, len, int64_t(pos) );
+         while( true ) {
+            ssize_t r = ::pread( fd, buf, len, off_t(pos) );
+            if( r >= 0 ) return size_t(r);
+            if( errno != EINTR )
+               FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+         }
+      }
+      void file_write( int fd, const char* buf, size_t len, uint64_t pos ) {
+         fc::thread& t = fc::thread::current();
+         while( len ) {
+            size_t w = 0;
+            if( t.get_io_engine() == fc::thread::uring_engine ) {
+               w = t.uring_write( fd, buf, len, int64_t(pos) );
+            } else {
+               ssize_t r = ::pwrite( fd, buf, len, off_t(pos) );
+               if( r < 0 ) {
+                  if( errno == EINTR ) continue;
+                  FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+               }
+               w = size_t(r);
+            }
+            buf += w; len -= w; pos += w;
+         }
+      }
+   }
+
+   class ofstream::impl : public fc::retainable {
+      public:
+         impl():fd(-1),pos(0){}
+         ~impl() {
+            try { close(); } catch( ... ) {}
+         }
+
+         /** @return false if the file is left to ofs */
+         bool open( const fc::path& file ) {
+            close();
+            if( fc::thread::current().get_io_engine() != fc::thread::uring_engine ) return false;
+            fd  = ::open( file.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+            pos = 0;
+            buf.reserve( 4096 );
+            return fd >= 0;
+         }
+         void write( const char* b, size_t len ) {
+            if( buf.size() + len > buf.capacity() ) {
+               flush();
+               if( len >= buf.capacity() ) {
+                  detail::file_write( fd, b, len, pos );
+                  pos += len;
+                  return;
+               }
+            }
+            buf.insert( buf.end(), b, b + len );
+         }
+         void flush() {
+            if( fd < 0 || buf.empty() ) return;
+            detail::file_write( fd, buf.data(), buf.size(), pos );
+            pos += buf.size();
+            buf.clear();
+         }
+         void close() {
+            if( fd < 0 ) return;
+            flush();
+            ::close(fd);
+            fd = -1;
+         }
+
+         std::ofstream     ofs;
+         int               fd;
+         uint64_t          pos;
+         std::vector<char> buf;
+   };
+
+   class ifstream::impl : public fc::retainable {
+      public:
+         impl():fd(-1),pos(0),good(false),rpos(0){}
+         ~impl(){ close(); }
+
+         /** @return false if the file is left to ifs */
+         bool open( const fc::path& file ) {
+            close();
+            if( fc::thread::current().get_io_engine() != fc::thread::uring_engine ) return false;
+            fd   = ::open( file.string().c_str(), O_RDONLY | O_CLOEXEC );
+            good = fd >= 0;
+            pos  = 0;
+            buf.clear();
+            rpos = 0;
+            return good;
+         }
+         /// @return bytes read, 0 at end of file
+         size_t read_some( char* b, size_t len ) {
+            if( rpos == buf.size() ) {
+               // large reads bypass the read ahead buffer
+               if( len >= 4096 ) {
+                  size_t r = detail::file_read( fd, b, len, pos );
+                  pos += r;
+                  return r;
+               }
+               buf.resize( 4096 );
+               buf.resize( detail::file_read( fd, buf.data(), buf.size(), pos ) );
+               pos += buf.size();
+               rpos = 0;
+               if( buf.empty() ) return 0;
+            }
+            size_t n = (fc::min)( len, buf.size() - rpos );
+            memcpy( b, buf.data() + rpos, n );
+            rpos += n;
+            return n;
+         }
+         void seek( int64_t off, int whence ) {
+            int64_t cur = int64_t(pos) - int64_t(buf.size() - rpos);
+            struct stat st;
+            switch( whence ) {
+               case SEEK_SET: cur = off; break;
+               case SEEK_CUR: cur += off; break;
+               case SEEK_END:
+                  if( fstat( fd, &st ) != 0 ) { good = false; return; }
+                  cur = int64_t(st.st_size) + off;
+                  break;
+            }
+            if( cur < 0 ) { good = false; return; }
+            pos  = uint64_t(cur);
+            good = true;
+            buf.clear();
+            rpos = 0;
+         }
+         void close() {
+            if( fd >= 0 ) ::close(fd);
+            fd   = -1;
+            good = false;
+         }
+
+         std::ifstream     ifs;
+         int               fd;
+         uint64_t          pos;  ///< file offset of buf.end()
+         bool              good;
+         std::vector<char> buf;
+         size_t            rpos;
+   };
+#else
    class ofstream::impl : public fc::retainable {
       public:
          std::ofstream ofs;
@@ -14,6 +175,7 @@ namespace fc {
       public:
          std::ifstream ifs;
    };
+#endif
 
    ofstream::ofstream()
    :my( new impl() ){}
@@ -23,19 +185,34 @@ namespace fc {
    ofstream::~ofstream(){}
 
    void ofstream::open( const fc::path& file, int m ) {
+#ifdef FC_FSTREAM_FD
+      if( my->open( file ) ) return;
+#endif
       my->ofs.open( file.string().c_str(), std::ios::binary );
    }
    size_t ofstream::writesome( const char* buf, size_t len ) {
+#ifdef FC_FSTREAM_FD
+        if( my->fd >= 0 ) { my->write( buf, len ); return len; }
+#endif
         my->ofs.write(buf,len);
         return len;
    }
    void   ofstream::put( char c ) {
+#ifdef FC_FSTREAM_FD
+        if( my->fd >= 0 ) { my->write( &c, 1 ); return; }
+#endif
         my->ofs.put(c);
    }
    void   ofstream::close() {
+#ifdef FC_FSTREAM_FD
+        if( my->fd >= 0 ) { my->close(); return; }
+#endif
         my->ofs.close();
    }
    void   ofstream::flush() {
+#ifdef FC_FSTREAM_FD
+        if( my->fd >= 0 ) { my->flush(); return; }
+#endif
         my->ofs.flush();
    }
 
@@ -49,9 +226,23 @@ namespace fc {
    ifstream::~ifstream(){}
 
    void ifstream::open( const fc::path& file, int m ) {
+#ifdef FC_FSTREAM_FD
+      if( my->open( file ) ) return;
+#endif
       my->ifs.open( file.string().c_str(), std::ios::binary );
    }
    size_t ifstream::readsome( char* buf, size_t len ) {
+#ifdef FC_FSTREAM_FD
+      if( my->fd >= 0 ) {
+         if( eof() ) FC_THROW_EXCEPTION( eof_exception , "");
+         auto s = my->read_some( buf, len );
+         if( s == 0 ) {
+            my->good = false;
+            FC_THROW_EXCEPTION( eof_exception , "");
+         }
+         return s;
+      }
+#endif
       auto s = size_t(my->ifs.readsome( buf, len ));
       if( s <= 0 ) {
          read( buf, 1 );
@@ -61,12 +252,35 @@ namespace fc {
    }
    ifstream& ifstream::read( char* buf, size_t len ) {
       if( eof() ) FC_THROW_EXCEPTION( eof_exception , "");
+#ifdef FC_FSTREAM_FD
+      if( my->fd >= 0 ) {
+         while( len ) {
+            size_t s = my->read_some( buf, len );
+            if( s == 0 ) {
+               my->good = false;
+               FC_THROW_EXCEPTION( eof_exception , "");
+            }
+            buf += s; len -= s;
+         }
+         return *this;
+      }
+#endif
       my->ifs.read(buf,len);
       if (my->ifs.gcount() < int64_t(len))
         FC_THROW_EXCEPTION( eof_exception , "");
       return *this;
    }
    ifstream& ifstream::seekg( size_t p, seekdir d ) {
+#ifdef FC_FSTREAM_FD
+      if( my->fd >= 0 ) {
+         switch( d ) {
+           case beg: my->seek( int64_t(p), SEEK_SET ); return *this;
+           case cur: my->seek( int64_t(p), SEEK_CUR ); return *this;
+           case end: my->seek( int64_t(p), SEEK_END ); return *this;
+         }
+         return *this;
+      }
+#endif
       switch( d ) {
         case beg: my->ifs.seekg( p, std::ios_base::beg ); return *this;
         case cur: my->ifs.seekg( p, std::ios_base::cur ); return *this;
@@ -74,9 +288,18 @@ namespace fc {
       }
       return *this;
    }
-   void   ifstream::close() { return my->ifs.close(); }
+   void   ifstream::close() {
+#ifdef FC_FSTREAM_FD
+      if( my->fd >= 0 ) { my->close(); return; }
+#endif
+      my->ifs.close();
+   }
 
-   bool   ifstream::eof()const { return !my->ifs.good(); }
+   bool   ifstream::eof()const {
+#ifdef FC_FSTREAM_FD
+      if( my->fd >= 0 ) return !my->good;
+#endif
+      return !my->ifs.good();
+   }
 
-  
-} // namespace fc 
+} // namespace fc
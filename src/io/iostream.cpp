@@ -7,6 +7,7 @@
 #include <fc/thread/mutex.hpp>
 #include <fc/thread/scoped_lock.hpp>
 #include <string>
+#include <vector>
 #include <boost/lexical_cast.hpp>
 #include <boost/thread/mutex.hpp>
 #include <fc/io/stdio.hpp>
@@ -354,4 +355,50 @@ namespace fc {
       return *this;
   }
 
+  size_t istream::readvsome( const mutable_buffer* bufs, size_t count )
+  {
+      for( size_t i = 0; i < count; ++i )
+         if( bufs[i].size ) return readsome( bufs[i].data, bufs[i].size );
+      return 0;
+  }
+
+  istream& istream::readv( const mutable_buffer* bufs, size_t count )
+  {
+      std::vector<mutable_buffer> rest( bufs, bufs + count );
+      size_t first = 0;
+      while( true ) {
+         while( first < rest.size() && rest[first].size == 0 ) ++first;
+         if( first == rest.size() ) return *this;
+         size_t r = readvsome( rest.data() + first, rest.size() - first );
+         for( ; r; ++first ) {
+            size_t n = (std::min)( r, rest[first].size );
+            rest[first].data += n; rest[first].size -= n; r -= n;
+            if( rest[first].size ) break;
+         }
+      }
+  }
+
+  size_t ostream::writevsome( const const_buffer* bufs, size_t count )
+  {
+      for( size_t i = 0; i < count; ++i )
+         if( bufs[i].size ) return writesome( bufs[i].data, bufs[i].size );
+      return 0;
+  }
+
+  ostream& ostream::writev( const const_buffer* bufs, size_t count )
+  {
+      std::vector<const_buffer> rest( bufs, bufs + count );
+      size_t first = 0;
+      while( true ) {
+         while( first < rest.size() && rest[first].size == 0 ) ++first;
+         if( first == rest.size() ) return *this;
+         size_t r = writevsome( rest.data() + first, rest.size() - first );
+         for( ; r; ++first ) {
+            size_t n = (std::min)( r, rest[first].size );
+            rest[first].data += n; rest[first].size -= n; r -= n;
+            if( rest[first].size ) break;
+         }
+      }
+  }
+
 }
@@ -0,0 +1,156 @@
+#include <fc/io/pipe.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/exception/exception.hpp>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+#include <string.h>
+
+namespace fc {
+
+  namespace detail {
+    /**
+     *  One direction of a pipe.  Only one fiber may read and one may write at a 
+     *  time, like a socket.
+     */
+    class pipe_buffer {
+      public:
+        pipe_buffer( size_t capacity )
+        :_data(capacity),_head(0),_size(0),_write_closed(false),_read_closed(false){}
+
+        size_t read( char* buf, size_t len ) {
+          while( true ) {
+            promise<void>::ptr wait;
+            promise<void>::ptr wake;
+            size_t n = 0;
+            {
+              boost::unique_lock<boost::mutex> lock( _mutex );
+              if( _size ) {
+                n = (std::min)( len, _size );
+                size_t first = (std::min)( n, _data.size() - _head );
+                memcpy( buf, _data.data() + _head, first );
+                memcpy( buf + first, _data.data(), n - first );
+                _head  = (_head + n) % _data.size();
+                _size -= n;
+                fc_swap( wake, _writer );
+              } else {
+                if( _write_closed || _read_closed ) FC_THROW_EXCEPTION( eof_exception, "" );
+                FC_ASSERT( !_reader, "another fiber is already reading from this pipe" );
+                wait = _reader = promise<void>::ptr( new promise<void>("fc::pipe::read") );
+              }
+            }
+            if( n ) {
+              if( wake ) wake->set_value();
+              return n;
+            }
+            try {
+              wait->wait();
+            } catch ( ... ) {
+              boost::unique_lock<boost::mutex> lock( _mutex );
+              if( _reader == wait ) _reader.reset();
+              throw;
+            }
+          }
+        }
+
+        size_t write( const char* buf, size_t len ) {
+          while( true ) {
+            promise<void>::ptr wait;
+            promise<void>::ptr wake;
+            size_t n = 0;
+            {
+              boost::unique_lock<boost::mutex> lock( _mutex );
+              if( _read_closed || _write_closed ) FC_THROW_EXCEPTION( eof_exception, "" );
+              if( _size < _data.size() ) {
+                n = (std::min)( len, _data.size() - _size );
+                size_t tail  = (_head + _size) % _data.size();
+                size_t first = (std::min)( n, _data.size() - tail );
+                memcpy( _data.data() + tail, buf, first );
+                memcpy( _data.data(), buf + first, n - first );
+                _size += n;
+                fc_swap( wake, _reader );
+              } else {
+                FC_ASSERT( !_writer, "another fiber is already writing to this pipe" );
+                wait = _writer = promise<void>::ptr( new promise<void>("fc::pipe::write") );
+              }
+            }
+            if( n ) {
+              if( wake ) wake->set_value();
+              return n;
+            }
+            try {
+              wait->wait();
+            } catch ( ... ) {
+              boost::unique_lock<boost::mutex> lock( _mutex );
+              if( _writer == wait ) _writer.reset();
+              throw;
+            }
+          }
+        }
+
+        /** called by the writing end, the reader drains what is buffered then sees eof */
+        void close_write() {
+          promise<void>::ptr wake;
+          {
+            boost::unique_lock<boost::mutex> lock( _mutex );
+            _write_closed = true;
+            fc_swap( wake, _reader );
+          }
+          if( wake ) wake->set_value();
+        }
+        /** called by the reading end, pending and future writes fail */
+        void close_read() {
+          promise<void>::ptr wake;
+          {
+            boost::unique_lock<boost::mutex> lock( _mutex );
+            _read_closed = true;
+            fc_swap( wake, _writer );
+          }
+          if( wake ) wake->set_value();
+        }
+
+      private:
+        boost::mutex       _mutex;
+        std::vector<char>  _data;
+        size_t             _head;  ///< offset of the first unread byte
+        size_t             _size;  ///< bytes buffered
+        bool               _write_closed;
+        bool               _read_closed;
+        promise<void>::ptr _reader; ///< set while a reader waits for data
+        promise<void>::ptr _writer; ///< set while a writer waits for room
+    };
+
+    class pipe_stream : public iostream {
+      public:
+        pipe_stream( const std::shared_ptr<pipe_buffer>& in, const std::shared_ptr<pipe_buffer>& out )
+        :_in(in),_out(out){}
+        ~pipe_stream() {
+          close();
+        }
+
+        virtual size_t readsome( char* buf, size_t len ) {
+          return _in->read( buf, len );
+        }
+        virtual size_t writesome( const char* buf, size_t len ) {
+          return _out->write( buf, len );
+        }
+        virtual void close() {
+          _out->close_write();
+          _in->close_read();
+        }
+        virtual void flush() {}
+
+      private:
+        std::shared_ptr<pipe_buffer> _in;
+        std::shared_ptr<pipe_buffer> _out;
+    };
+  }
+
+  std::pair<iostream_ptr,iostream_ptr> make_pipe( size_t capacity ) {
+    FC_ASSERT( capacity > 0 );
+    auto a_to_b = std::make_shared<detail::pipe_buffer>( capacity );
+    auto b_to_a = std::make_shared<detail::pipe_buffer>( capacity );
+    return std::make_pair( iostream_ptr( std::make_shared<detail::pipe_stream>( b_to_a, a_to_b ) ),
+                           iostream_ptr( std::make_shared<detail::pipe_stream>( a_to_b, b_to_a ) ) );
+  }
+
+} // namespace fc
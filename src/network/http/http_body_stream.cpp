@@ -0,0 +1,189 @@
+#include <fc/network/http/body_stream.hpp>
+#include <fc/exception/exception.hpp>
+#include <string.h>
+#include <stdio.h>
+
+namespace fc { namespace http {
+
+  namespace detail {
+    /** chunk size lines, trailer fields and chunk extensions must fit */
+    const size_t max_chunk_line = 8*1024;
+  }
+
+  body_istream::body_istream( read_buffer& buf, istream& src, framing_type f, uint64_t length )
+  :_buf(buf),_src(src),_framing(f),_state(data),_length(length),_remaining(length),_read(0) {
+    if( f == chunked )                           _state = chunk_size;
+    else if( f == content_length && length == 0 ) _state = finished;
+  }
+
+  size_t body_istream::next_line() {
+    const char* nl;
+    while( !(nl = (const char*)memchr( _buf.data(), '\n', _buf.size() )) ) {
+      if( _buf.size() >= detail::max_chunk_line )
+        FC_THROW_EXCEPTION( parse_error_exception, "chunk line exceeds ${max} bytes", ("max", uint64_t(detail::max_chunk_line)) );
+      try {
+        _buf.fill( _src, 64*1024 );
+      } catch ( const fc::eof_exception& ) {
+        FC_THROW_EXCEPTION( parse_error_exception, "connection closed in the middle of a chunked body" );
+      }
+    }
+    return nl - _buf.data() + 1;
+  }
+
+  size_t body_istream::read_data( char* out, size_t len ) {
+    if( _framing != until_eof && len > _remaining ) len = size_t(_remaining);
+    size_t n;
+    if( _buf.size() ) {
+      n = (std::min)( len, _buf.size() );
+      memcpy( out, _buf.data(), n );
+      _buf.consume( n );
+    } else {
+      try {
+        n = _src.readsome( out, len );
+      } catch ( const fc::eof_exception& ) {
+        if( _framing != until_eof )
+          FC_THROW_EXCEPTION( parse_error_exception, "connection closed in the middle of the body" );
+        _state = finished;
+        throw;
+      }
+    }
+    _read += n;
+    if( _framing != until_eof ) _remaining -= n;
+    return n;
+  }
+
+  size_t body_istream::readsome( char* out, size_t len ) {
+    while( true ) {
+      switch( _state ) {
+        case data: {
+          size_t n = read_data( out, len );
+          if( _framing != until_eof && _remaining == 0 )
+            _state = _framing == chunked ? chunk_end : finished;
+          return n;
+        }
+        case chunk_size: {
+          size_t      line_len = next_line();
+          const char* c        = _buf.data();
+          uint64_t    size     = 0;
+          size_t      digits   = 0;
+          for( ; ; ++c, ++digits ) {
+            int v;
+            if( *c >= '0' && *c <= '9' )      v = *c - '0';
+            else if( *c >= 'a' && *c <= 'f' ) v = *c - 'a' + 10;
+            else if( *c >= 'A' && *c <= 'F' ) v = *c - 'A' + 10;
+            else break;
+            if( digits == 15 )
+              FC_THROW_EXCEPTION( parse_error_exception, "chunk size too large" );
+            size = size * 16 + uint64_t(v);
+          }
+          // anything after the size must be a chunk extension
+          if( digits == 0 || (*c != ';' && *c != '\r' && *c != '\n' && *c != ' ' && *c != '\t') )
+            FC_THROW_EXCEPTION( parse_error_exception, "malformed chunk size" );
+          _buf.consume( line_len );
+          _remaining = size;
+          _state     = size ? data : trailer;
+          break;
+        }
+        case chunk_end: {
+          size_t line_len = next_line();
+          if( line_len > 2 || (line_len == 2 && _buf.data()[0] != '\r') )
+            FC_THROW_EXCEPTION( parse_error_exception, "chunk not followed by CRLF" );
+          _buf.consume( line_len );
+          _state = chunk_size;
+          break;
+        }
+        case trailer: {
+          size_t line_len = next_line();
+          bool   last     = line_len == 1 || (line_len == 2 && _buf.data()[0] == '\r');
+          _buf.consume( line_len );
+          if( last ) _state = finished;
+          break;
+        }
+        case finished:
+          FC_THROW_EXCEPTION( eof_exception, "end of body" );
+      }
+    }
+  }
+
+  void body_istream::skip() {
+    char tmp[4096];
+    try {
+      while( !done() ) readsome( tmp, sizeof(tmp) );
+    } catch ( const fc::eof_exception& ) {}
+  }
+
+  void body_istream::read_all( std::vector<char>& out, uint64_t max_size ) {
+    if( _state == data && _framing == content_length ) {
+      if( _remaining > max_size )
+        FC_THROW_EXCEPTION( out_of_range_exception, "body of ${n} bytes exceeds ${max}", ("n",_remaining)("max",max_size) );
+      size_t n = out.size();
+      out.resize( n + size_t(_remaining) );
+      read( out.data() + n, out.size() - n );
+      return;
+    }
+    size_t first = out.size();
+    size_t n     = first;
+    try {
+      while( !done() ) {
+        // one byte beyond max_size tells a body that is too long from one that just fits
+        uint64_t left = max_size - (n - first);
+        size_t   room = (std::max)( size_t(4096), n );
+        if( left < room ) room = size_t(left) + 1;
+        out.resize( n + room );
+        n += readsome( out.data() + n, room );
+        if( n - first > max_size ) {
+          out.resize( n );
+          FC_THROW_EXCEPTION( out_of_range_exception, "body exceeds ${max} bytes", ("max",max_size) );
+        }
+      }
+    } catch ( const fc::eof_exception& ) {
+      out.resize( n );
+      if( !done() ) throw;
+    }
+    out.resize( n );
+  }
+
+  void body_istream::copy_to( fc::ostream& out ) {
+    std::vector<char> tmp( 64*1024 );
+    try {
+      while( !done() ) out.write( tmp.data(), readsome( tmp.data(), tmp.size() ) );
+    } catch ( const fc::eof_exception& ) {
+      if( !done() ) throw;
+    }
+  }
+
+
+  chunked_ostream::chunked_ostream( ostream& out )
+  :_out(out),_closed(false){}
+
+  void chunked_ostream::write_chunk( const char* data, size_t len, const const_buffer* head ) {
+    FC_ASSERT( !_closed, "write after the last chunk" );
+    char size_line[20];
+    int  n = snprintf( size_line, sizeof(size_line), "%llx\r\n", (unsigned long long)len );
+    const_buffer bufs[4];
+    size_t count = 0;
+    if( head && head->size ) bufs[count++] = *head;
+    if( len ) {
+      bufs[count++] = const_buffer( size_line, size_t(n) );
+      bufs[count++] = const_buffer( data, len );
+      bufs[count++] = const_buffer( "\r\n", 2 );
+    }
+    if( count ) _out.writev( bufs, count );
+  }
+
+  size_t chunked_ostream::writesome( const char* buf, size_t len ) {
+    write_chunk( buf, len );
+    return len;
+  }
+
+  void chunked_ostream::close() {
+    if( _closed ) return;
+    _out.write( "0\r\n\r\n", 5 );
+    _closed = true;
+  }
+
+  void chunked_ostream::flush() {
+    _out.flush();
+  }
+
+} } // fc::http
@@ -0,0 +1,318 @@
+#include <fc/network/http/client.hpp>
+#include <fc/network/http/body_stream.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/network/resolve.hpp>
+#include <fc/network/ip.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+#include <unordered_map>
+#include <deque>
+#include <algorithm>
+
+namespace fc { namespace http {
+
+  namespace detail {
+    struct pooled_connection {
+      pooled_connection():used(false){}
+      connection_ptr con;
+      time_point     last_used;
+      bool           used;      ///< a request has been sent on it before
+    };
+
+    struct host_pool {
+      host_pool():port(80),open(0),created(0),reused(0){}
+      fc::string                                       host;
+      uint16_t                                         port;
+      std::vector<pooled_connection>                   idle;    ///< most recently used last
+      /**
+       *  Handed a connection when one is released, or an empty one when a connection
+       *  closed and the waiter may open its own.
+       */
+      std::deque<promise<pooled_connection>::ptr>      waiters;
+      uint32_t                                         open;    ///< includes connections handed to waiters
+      uint64_t                                         created;
+      uint64_t                                         reused;
+    };
+
+    void split_url( const fc::string& url, fc::string& host, uint16_t& port, fc::string& target ) {
+      const fc::string scheme = "http://";
+      if( url.compare( 0, scheme.size(), scheme ) != 0 )
+        FC_THROW_EXCEPTION( invalid_arg_exception, "unsupported url ${url}", ("url", url) );
+      size_t h     = scheme.size();
+      size_t slash = url.find( '/', h );
+      fc::string authority = url.substr( h, slash == fc::string::npos ? fc::string::npos : slash - h );
+      target = slash == fc::string::npos ? fc::string("/") : url.substr( slash );
+      size_t colon = authority.find( ':' );
+      host = authority.substr( 0, colon );
+      port = 80;
+      if( colon != fc::string::npos ) {
+        uint64_t p = 0;
+        for( size_t i = colon + 1; i < authority.size(); ++i ) {
+          if( authority[i] < '0' || authority[i] > '9' || (p = p * 10 + uint64_t(authority[i] - '0')) > 0xffff )
+            FC_THROW_EXCEPTION( invalid_arg_exception, "invalid port in ${url}", ("url", url) );
+        }
+        port = uint16_t(p);
+      }
+      if( host.empty() )
+        FC_THROW_EXCEPTION( invalid_arg_exception, "no host in ${url}", ("url", url) );
+    }
+
+    bool is_idempotent( const fc::string& method ) {
+      return method == "GET" || method == "HEAD" || method == "PUT" || method == "DELETE" || method == "OPTIONS";
+    }
+  }
+
+  class client::impl {
+    public:
+      impl( uint32_t max_per_host )
+      :thread( fc::thread::current() ),max_connections(max_per_host),idle_timeout( fc::seconds(30) ),
+       max_reply_body( body_istream::default_max_size ),in_flight(0),closing(false){
+        FC_ASSERT( max_per_host > 0 );
+      }
+
+      /** streams the bodies instead if body_stream or reply_body are given */
+      reply run( const fc::string& method, const fc::string& url, const fc::string& body, const headers& h,
+                 const fc::istream_ptr& body_stream = fc::istream_ptr(), 
+                 const fc::ostream_ptr& reply_body = fc::ostream_ptr() ) {
+        fc::string host, target;
+        uint16_t   port;
+        detail::split_url( url, host, port, target );
+        fc::string key = port == 80 ? host : host + ":" + fc::to_string( uint64_t(port) );
+        // a stream may have been consumed by the failed attempt
+        bool streamed = body_stream || reply_body;
+
+        ++in_flight;
+        struct in_flight_guard {
+          impl* self;
+          ~in_flight_guard() {
+            if( --self->in_flight == 0 && self->drained ) self->drained->set_value();
+          }
+        } guard = { this };
+
+        for( uint32_t attempt = 0; ; ++attempt ) {
+          detail::pooled_connection pc = acquire( key, host, port, attempt > 0 );
+          time_point idle_since = pc.last_used;
+          bool       reused     = pc.used;
+          pc.con->set_max_reply_body( max_reply_body );
+          try {
+            reply r = streamed ? pc.con->send_request( method, target, key, body_stream.get(), reply_body.get(), h )
+                               : pc.con->send_request( method, target, key, body, h );
+            release( key, pc );
+            return r;
+          } catch ( const fc::eof_exception& ) {
+            release( key, pc );
+            // closed while idle, the server never saw the request
+            if( !reused || attempt > 0 || streamed ) throw;
+          } catch ( const fc::out_of_range_exception& ) {
+            // the reply would be too long again
+            release( key, pc );
+            throw;
+          } catch ( const fc::exception& ) {
+            release( key, pc );
+            if( !reused || attempt > 0 || streamed || !detail::is_idempotent( method ) ) throw;
+          }
+          // connections idle for longer were most likely closed by the server as well
+          close_idle( pools[key], idle_since );
+        }
+      }
+
+      /** @param fresh do not reuse an idle connection */
+      detail::pooled_connection acquire( const fc::string& key, const fc::string& host, uint16_t port, bool fresh ) {
+        detail::host_pool& hp = pools[key];
+        hp.host = host;
+        hp.port = port;
+        time_point now = time_point::now();
+        if( fresh && !hp.idle.empty() && hp.open >= max_connections ) {
+          // make room for the new connection
+          hp.idle.front().con->get_socket().close();
+          hp.idle.erase( hp.idle.begin() );
+          --hp.open;
+        }
+        while( !fresh && !hp.idle.empty() ) {
+          detail::pooled_connection pc = hp.idle.back();
+          hp.idle.pop_back();
+          if( pc.con->get_socket().is_open() && now - pc.last_used < idle_timeout ) {
+            ++hp.reused;
+            return pc;
+          }
+          pc.con->get_socket().close();
+          --hp.open;
+        }
+
+        if( hp.open >= max_connections ) {
+          promise<detail::pooled_connection>::ptr p( new promise<detail::pooled_connection>("http::client::acquire") );
+          hp.waiters.push_back( p );
+          detail::pooled_connection pc;
+          try {
+            pc = p->wait();
+          } catch ( ... ) {
+            abandon( key, hp, p );
+            throw;
+          }
+          if( pc.con ) {
+            ++hp.reused;
+            return pc;
+          }
+          // the slot of a closed connection was handed to us
+        } else {
+          ++hp.open;
+        }
+
+        detail::pooled_connection pc;
+        try {
+          std::vector<fc::ip::endpoint> eps = fc::resolve( host, port );
+          if( eps.empty() ) FC_THROW_EXCEPTION( exception, "unable to resolve ${host}", ("host", host) );
+          pc.con = std::make_shared<connection>();
+          for( size_t i = 0; ; ++i ) {
+            try {
+              pc.con->connect_to( eps[i] );
+              break;
+            } catch ( const fc::exception& ) {
+              if( i + 1 == eps.size() ) throw;
+            }
+          }
+        } catch ( ... ) {
+          free_slot( hp );
+          throw;
+        }
+        ++hp.created;
+        return pc;
+      }
+
+      /** 
+       *  Takes p, whose request was canceled while waiting, out of the waiters, or passes
+       *  on what it was handed meanwhile.
+       */
+      void abandon( const fc::string& key, detail::host_pool& hp, const promise<detail::pooled_connection>::ptr& p ) {
+        auto itr = std::find( hp.waiters.begin(), hp.waiters.end(), p );
+        if( itr != hp.waiters.end() ) {
+          hp.waiters.erase( itr );
+          return;
+        }
+        detail::pooled_connection pc;
+        try {
+          pc = p->wait();
+        } catch ( ... ) {}
+        if( pc.con ) release( key, pc );
+        else         free_slot( hp );
+      }
+
+      /** returns pc to its pool, or frees its slot if the connection can not be reused */
+      void release( const fc::string& key, detail::pooled_connection& pc ) {
+        detail::host_pool& hp = pools[key];
+        pc.used      = true;
+        pc.last_used = time_point::now();
+        if( closing || !pc.con->get_socket().is_open() ) {
+          pc.con->get_socket().close();
+          free_slot( hp );
+          return;
+        }
+        if( !hp.waiters.empty() ) {
+          promise<detail::pooled_connection>::ptr p = hp.waiters.front();
+          hp.waiters.pop_front();
+          p->set_value( pc );
+          return;
+        }
+        hp.idle.push_back( pc );
+      }
+
+      /** closes the idle connections last used no later than t */
+      void close_idle( detail::host_pool& hp, const time_point& t ) {
+        size_t kept = 0;
+        for( size_t i = 0; i < hp.idle.size(); ++i ) {
+          if( hp.idle[i].last_used <= t ) {
+            hp.idle[i].con->get_socket().close();
+            --hp.open;
+          } else {
+            hp.idle[kept++] = hp.idle[i];
+          }
+        }
+        hp.idle.resize( kept );
+      }
+
+      void free_slot( detail::host_pool& hp ) {
+        if( hp.waiters.empty() ) {
+          --hp.open;
+          return;
+        }
+        promise<detail::pooled_connection>::ptr p = hp.waiters.front();
+        hp.waiters.pop_front();
+        p->set_value( detail::pooled_connection() );
+      }
+
+      std::vector<client::pool_stats> get_stats()const {
+        std::vector<client::pool_stats> r;
+        r.reserve( pools.size() );
+        for( auto itr = pools.begin(); itr != pools.end(); ++itr ) {
+          client::pool_stats s;
+          s.host        = itr->first;
+          s.connections = itr->second.open;
+          s.idle        = uint32_t(itr->second.idle.size());
+          s.waiting     = uint32_t(itr->second.waiters.size());
+          s.created     = itr->second.created;
+          s.reused      = itr->second.reused;
+          r.push_back( s );
+        }
+        return r;
+      }
+
+      void drain() {
+        closing = true;
+        if( in_flight == 0 ) return;
+        drained.reset( new promise<void>("http::client::drain") );
+        drained->wait();
+      }
+
+      fc::thread&                                            thread;
+      uint32_t                                               max_connections;
+      microseconds                                           idle_timeout;
+      uint64_t                                               max_reply_body;
+      std::unordered_map<fc::string, detail::host_pool>      pools;
+      uint32_t                                               in_flight;
+      bool                                                   closing;
+      promise<void>::ptr                                     drained;
+  };
+
+  client::client( uint32_t max_connections_per_host )
+  :my( new impl( max_connections_per_host ) ){}
+
+  client::~client() {
+    try {
+      if( my->thread.is_current() ) my->drain();
+      else my->thread.async( [this](){ my->drain(); }, "http::client::drain" ).wait();
+    } catch ( ... ) {}
+  }
+
+  void client::set_max_connections_per_host( uint32_t n ) {
+    FC_ASSERT( n > 0 );
+    my->max_connections = n;
+  }
+  void client::set_idle_timeout( const microseconds& t ) {
+    my->idle_timeout = t;
+  }
+  void client::set_max_reply_body( uint64_t n ) {
+    my->max_reply_body = n;
+  }
+
+  fc::future<reply> client::request( const fc::string& method, const fc::string& url,
+                                     const fc::string& body, const headers& h ) {
+    impl* self = my.get();
+    return my->thread.async( [=](){ return self->run( method, url, body, h ); }, "http::client::request" );
+  }
+
+  fc::future<reply> client::request( const fc::string& method, const fc::string& url,
+                                     const fc::istream_ptr& body, const fc::ostream_ptr& reply_body,
+                                     const headers& h ) {
+    impl* self = my.get();
+    return my->thread.async( [=](){ return self->run( method, url, fc::string(), h, body, reply_body ); }, 
+                             "http::client::request" );
+  }
+
+  std::vector<client::pool_stats> client::get_pool_stats()const {
+    if( my->thread.is_current() ) return my->get_stats();
+    impl* self = my.get();
+    return my->thread.async( [=](){ return self->get_stats(); }, "http::client::get_pool_stats" ).wait();
+  }
+
+} } // fc::http
@@ -0,0 +1,193 @@
+#include <fc/network/http/compression.hpp>
+#include <fc/network/http/header_index.hpp>
+#include <fc/exception/exception.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+
+namespace fc { namespace http {
+
+  namespace detail {
+    /** zlib writes its output in pieces of this size */
+    const size_t zlib_step = 16*1024;
+
+    bool token_is( const char* t, size_t len, const char* name ) {
+      return iequals( t, len, name, strlen(name) );
+    }
+  }
+
+  namespace content_coding {
+    type parse( const fc::string& v ) {
+      size_t b = v.find_first_not_of( " \t" );
+      if( b == fc::string::npos ) return identity;
+      size_t e = v.find_last_not_of( " \t" ) + 1;
+      const char* t = v.c_str() + b;
+      if( detail::token_is( t, e - b, "gzip" ) || detail::token_is( t, e - b, "x-gzip" ) ) return gzip;
+      if( detail::token_is( t, e - b, "deflate" ) ) return deflate;
+      return identity;
+    }
+
+    const char* name( type t ) {
+      switch( t ) {
+        case gzip:    return "gzip";
+        case deflate: return "deflate";
+        default:      return "identity";
+      }
+    }
+
+    type negotiate( const fc::string& v ) {
+      // the quality of gzip, deflate and *, -1 if not listed
+      int q[3] = { -1, -1, -1 };
+      size_t i = 0;
+      while( i < v.size() ) {
+        size_t e = v.find( ',', i );
+        if( e == fc::string::npos ) e = v.size();
+        size_t ts = v.find_first_not_of( " \t", i );
+        if( ts == fc::string::npos || ts >= e ) { i = e + 1; continue; }
+        size_t te = v.find_first_of( " \t;", ts );
+        if( te == fc::string::npos || te > e ) te = e;
+
+        // q=0 to q=1 with up to 3 decimals, kept in thousandths
+        int    quality = 1000;
+        size_t qp = v.find( "q=", te );
+        if( qp != fc::string::npos && qp < e ) {
+          const char* p = v.c_str() + qp + 2;
+          quality = (*p == '1') ? 1000 : 0;
+          if( *p == '0' && p[1] == '.' ) {
+            int scale = 100;
+            for( p += 2; *p >= '0' && *p <= '9' && scale; ++p, scale /= 10 ) quality += (*p - '0') * scale;
+          }
+        }
+
+        const char* t = v.c_str() + ts;
+        if( detail::token_is( t, te - ts, "gzip" ) || detail::token_is( t, te - ts, "x-gzip" ) ) q[0] = quality;
+        else if( detail::token_is( t, te - ts, "deflate" ) )                                    q[1] = quality;
+        else if( detail::token_is( t, te - ts, "*" ) )                                          q[2] = quality;
+        i = e + 1;
+      }
+      if( q[0] < 0 ) q[0] = q[2];
+      if( q[1] < 0 ) q[1] = q[2];
+      if( q[0] > 0 && q[0] >= q[1] ) return gzip;
+      if( q[1] > 0 )                 return deflate;
+      return identity;
+    }
+
+    fc::string tag( const fc::string& etag, type t ) {
+      if( t == identity || etag.size() < 2 || etag[etag.size()-1] != '"' ) return etag;
+      return etag.substr( 0, etag.size() - 1 ) + "-" + name( t ) + "\"";
+    }
+  }
+
+  bool is_compressible_type( const fc::string& t ) {
+    if( t.empty() ) return true;
+    if( t.compare( 0, 5, "text/" ) == 0 ) return true;
+    return t.find( "json" ) != fc::string::npos || t.find( "javascript" ) != fc::string::npos ||
+           t.find( "xml" )  != fc::string::npos || t.find( "x-www-form-urlencoded" ) != fc::string::npos;
+  }
+
+
+  class deflater::impl {
+    public:
+      impl() { memset( &z, 0, sizeof(z) ); }
+      ~impl() { deflateEnd( &z ); }
+      z_stream z;
+  };
+
+  deflater::deflater( content_coding::type c, int level )
+  :my( new impl() ) {
+    FC_ASSERT( c != content_coding::identity );
+    // 16 more window bits ask for the gzip wrapper instead of the zlib one
+    int r = deflateInit2( &my->z, level, Z_DEFLATED, c == content_coding::gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY );
+    if( r != Z_OK ) FC_THROW( "unable to initialize zlib: ${r}", ("r",r) );
+  }
+  deflater::~deflater(){}
+
+  void deflater::compress( const char* data, size_t len, std::vector<char>& out, flush_type f ) {
+    z_stream& z = my->z;
+    z.next_in  = (Bytef*)data;
+    z.avail_in = uInt(len);
+    int flush  = f == finish ? Z_FINISH : f == sync_flush ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+    do {
+      size_t n = out.size();
+      out.resize( n + detail::zlib_step );
+      z.next_out  = (Bytef*)out.data() + n;
+      z.avail_out = uInt(detail::zlib_step);
+      int r = ::deflate( &z, flush );
+      out.resize( out.size() - z.avail_out );
+      if( r == Z_STREAM_END ) break;
+      if( r != Z_OK && r != Z_BUF_ERROR ) FC_THROW( "zlib failed to compress: ${r}", ("r",r) );
+      // zlib is done with the input once it leaves room in the output
+    } while( z.avail_out == 0 || z.avail_in != 0 || (f == finish) );
+  }
+
+
+  class inflater::impl {
+    public:
+      impl():done(false) { memset( &z, 0, sizeof(z) ); }
+      ~impl() { inflateEnd( &z ); }
+      z_stream z;
+      bool     done;
+  };
+
+  inflater::inflater()
+  :my( new impl() ) {
+    // 32 more window bits detect the gzip or zlib header
+    int r = inflateInit2( &my->z, 15 + 32 );
+    if( r != Z_OK ) FC_THROW( "unable to initialize zlib: ${r}", ("r",r) );
+  }
+  inflater::~inflater(){}
+
+  bool inflater::done()const { return my->done; }
+
+  size_t inflater::decompress( const char* data, size_t len, std::vector<char>& out, uint64_t max_size ) {
+    z_stream& z = my->z;
+    z.next_in  = (Bytef*)data;
+    z.avail_in = uInt(len);
+    while( !my->done && (z.avail_in || z.avail_out == 0) ) {
+      size_t n = out.size();
+      out.resize( n + detail::zlib_step );
+      z.next_out  = (Bytef*)out.data() + n;
+      z.avail_out = uInt(detail::zlib_step);
+      int r = ::inflate( &z, Z_NO_FLUSH );
+      out.resize( out.size() - z.avail_out );
+      if( out.size() > max_size )
+        FC_THROW_EXCEPTION( out_of_range_exception, "decompressed body exceeds ${max} bytes", ("max",max_size) );
+      if( r == Z_STREAM_END ) my->done = true;
+      else if( r == Z_BUF_ERROR ) break;
+      else if( r != Z_OK )
+        FC_THROW_EXCEPTION( parse_error_exception, "invalid compressed body: ${msg}", ("msg", z.msg ? z.msg : "") );
+    }
+    return len - z.avail_in;
+  }
+
+
+  inflate_istream::inflate_istream( istream& src )
+  :_src(src),_in( 16*1024 ),_out_pos(0){}
+
+  size_t inflate_istream::readsome( char* buf, size_t len ) {
+    while( _out_pos == _out.size() ) {
+      if( _inflater.done() ) {
+        // whatever follows the stream is ignored, but read so that src reaches its end
+        try {
+          while( true ) _src.readsome( _in.data(), _in.size() );
+        } catch ( const fc::eof_exception& ) {}
+        FC_THROW_EXCEPTION( eof_exception, "end of compressed body" );
+      }
+      size_t n;
+      try {
+        n = _src.readsome( _in.data(), _in.size() );
+      } catch ( const fc::eof_exception& ) {
+        FC_THROW_EXCEPTION( parse_error_exception, "compressed body ended before its stream" );
+      }
+      _out.clear();
+      _out_pos = 0;
+      _inflater.decompress( _in.data(), n, _out );
+    }
+    size_t n = (std::min)( len, _out.size() - _out_pos );
+    memcpy( buf, _out.data() + _out_pos, n );
+    _out_pos += n;
+    return n;
+  }
+
+} } // fc::http
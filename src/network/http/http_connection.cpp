@@ -1,4 +1,7 @@
 #include <fc/network/http/connection.hpp>
+#include <fc/network/http/parser.hpp>
+#include <fc/network/http/body_stream.hpp>
+#include <fc/network/http/compression.hpp>
 #include <fc/network/tcp_socket.hpp>
 #include <fc/io/sstream.hpp>
 #include <fc/io/iostream.hpp>
@@ -7,66 +10,238 @@
 #include <fc/crypto/hex.hpp>
 #include <fc/log/logger.hpp>
 #include <fc/io/stdio.hpp>
+#include <string.h>
 
 
+namespace fc { namespace http { namespace detail {
+   /** @return true if the comma separated list v contains token, ignoring case */
+   bool has_token( const char* v, size_t len, const char* token ) {
+      const char* end = v + len;
+      while( v < end ) {
+         while( v < end && (*v == ' ' || *v == '\t' || *v == ',') ) ++v;
+         const char* e = v;
+         while( e < end && *e != ',' ) ++e;
+         const char* te = e;
+         while( te > v && (te[-1] == ' ' || te[-1] == '\t') ) --te;
+         if( te > v && iequals( v, te - v, token, strlen(token) ) ) return true;
+         v = e;
+      }
+      return false;
+   }
+   /** brings idx up to date with fields appended to hs */
+   void update_index( const std::vector<header>& hs, header_index& idx ) {
+      if( idx.size() > hs.size() ) idx.clear();
+      for( size_t i = idx.size(); i < hs.size(); ++i ) idx.add( hs[i].key.c_str(), hs[i].key.size() );
+   }
+   fc::string header_value( const std::vector<header>& hs, header_index& idx, const fc::string& key ) {
+      update_index( hs, idx );
+      uint32_t i = idx.find( key.c_str(), key.size(), [&]( uint32_t n ) { 
+         return const_buffer( hs[n].key.c_str(), hs[n].key.size() ); 
+      } );
+      return i == header_index::npos ? fc::string() : hs[i].val;
+   }
+   fc::string header_value( const std::vector<header>& hs, header_index& idx, header_id::type id ) {
+      update_index( hs, idx );
+      uint32_t i = idx.find( id );
+      return i == header_index::npos ? fc::string() : hs[i].val;
+   }
+} } }
+
 class fc::http::connection::impl 
 {
   public:
-   fc::tcp_socket sock;
-   fc::ip::endpoint ep;
-   impl() {
+   fc::tcp_socket_ptr    sock_ptr;
+   fc::tcp_socket&       sock;
+   fc::ip::endpoint      ep;
+   http::read_buffer     buf;
+   http::head_parser     req_parser;
+   http::head_parser     rep_parser;
+   /** of the last request read */
+   std::shared_ptr<http::body_istream> req_body;
+   /** the last request asked for a compressed reply, which read_reply() decompresses */
+   bool                  decode_reply;
+   uint64_t              max_reply_body;
+   impl( const fc::tcp_socket_ptr& s )
+   :sock_ptr(s),sock(*s),req_parser( http::head_parser::request_head ),rep_parser( http::head_parser::response_head ),
+    decode_reply(false),max_reply_body( body_istream::default_max_size ){
    }
 
-   int read_until( char* buffer, char* end, char c = '\n' ) {
-      char* p = buffer;
-     // try {
-          while( p < end && 1 == sock.readsome(p,1) ) {
-            if( *p == c ) {
-              *p = '\0';
-              return (p - buffer)-1;
-            }
-            ++p;
-          }
-     // } catch ( ... ) {
-     //   elog("%s", fc::current_exception().diagnostic_information().c_str() );
-        //elog( "%s", fc::except_str().c_str() );
-     // }
-      return (p-buffer);
+   /**
+    *  Reads until p has parsed a complete head at the front of buf.
+    *  @return the length of the head
+    */
+   size_t read_head( http::head_parser& p, const time_point& deadline = time_point::maximum() ) {
+      p.reset();
+      size_t head_len;
+      while( (head_len = p.parse( buf.data(), buf.size() )) == 0 ) {
+        if( deadline == time_point::maximum() ) {
+          buf.fill( sock, 64*1024 );
+        } else {
+          mutable_buffer b = buf.prepare( 64*1024 );
+          buf.commit( sock.readsome_until( b.data, b.size, deadline ) );
+        }
+      }
+      return head_len;
    }
 
-   fc::http::reply parse_reply() {
-      fc::http::reply rep;
+   /** what read_headers() found out about the message */
+   struct head_info : head_parser::framing {
+      head_info():close(false),keep_alive(false){}
+      bool     close;       ///< Connection: close
+      bool     keep_alive;  ///< Connection: keep-alive
+   };
+
+   /** 
+    *  Copies the header fields out of the head, handling the ones that affect the body.
+    *  @throw parse_error_exception if the head does not frame the body unambiguously,
+    *         see head_parser::body_framing()
+    */
+   head_info read_headers( const http::head_parser& p, std::vector<header>& hs, header_index& idx,
+                           fc::string* domain = nullptr ) {
+      head_info info;
+      const char* d = buf.data();
+      hs.reserve( p.headers().size() );
+      for( auto itr = p.headers().begin(); itr != p.headers().end(); ++itr )
+        hs.push_back( header( head_parser::str( d, itr->key ), head_parser::str( d, itr->val ) ) );
+      idx = p.index();
+
+      static_cast<head_parser::framing&>( info ) = p.body_framing( d );
+      if( const head_parser::header_field* f = p.find( header_id::connection ) ) {
+        info.close      = detail::has_token( d + f->val.offset, f->val.length, "close" );
+        info.keep_alive = detail::has_token( d + f->val.offset, f->val.length, "keep-alive" );
+      }
+      if( domain ) {
+        if( const head_parser::header_field* f = p.find( header_id::host ) )
+          *domain = head_parser::str( d, f->val );
+      }
+      return info;
+   }
+
+   /** @param framing the header field delimiting the body, if any */
+   fc::string request_head( const fc::string& method, const fc::string& target, const fc::string& host,
+                            const headers& he, const fc::string& framing ) {
+      fc::stringstream req;
+      req << method <<" "<<target<<" HTTP/1.1\r\n";
+      req << "Host: "<<host<<"\r\n";
+      bool has_type = false;
+      decode_reply  = true;
+      for( auto i = he.begin(); i != he.end(); ++i )
+      {
+          req << i->key <<": " << i->val<<"\r\n";
+          header_id::type id = header_id::lookup( i->key.c_str(), i->key.size() );
+          has_type     |= id == header_id::content_type;
+          // the caller asked for an encoding it handles itself
+          decode_reply &= id != header_id::accept_encoding;
+      }
+      if( !has_type ) req << "Content-Type: application/json\r\n";
+      if( decode_reply ) req << "Accept-Encoding: gzip, deflate\r\n";
+      if( framing.size() ) req << framing << "\r\n";
+      req << "\r\n"; 
+      return req.str();
+   }
+
+   void write_request( const fc::string& method, const fc::string& target, const fc::string& host,
+                       const fc::string& body, const headers& he ) {
+      fc::string head = request_head( method, target, host, he, 
+                                      body.size() ? "Content-Length: " + fc::to_string( uint64_t(body.size()) ) : fc::string() );
+      const_buffer bufs[2] = { const_buffer( head.c_str(), head.size() ), 
+                               const_buffer( body.c_str(), body.size() ) };
+      sock.writev( bufs, 2 );
+   }
+
+   /** sends the body read from body with the chunked transfer coding */
+   void write_request( const fc::string& method, const fc::string& target, const fc::string& host,
+                       fc::istream& body, const headers& he ) {
+      fc::string head = request_head( method, target, host, he, "Transfer-Encoding: chunked" );
+      const_buffer    h( head.c_str(), head.size() );
+      chunked_ostream out( sock );
+      std::vector<char> chunk( 64*1024 );
+      bool head_sent = false;
       try {
-        std::vector<char> line(1024*8);
-        int s = read_until( line.data(), line.data()+line.size(), ' ' ); // HTTP/1.1
-        s = read_until( line.data(), line.data()+line.size(), ' ' ); // CODE
-        rep.status = static_cast<int>(to_int64(fc::string(line.data())));
-        s = read_until( line.data(), line.data()+line.size(), '\n' ); // DESCRIPTION
-        
-        while( (s = read_until( line.data(), line.data()+line.size(), '\n' )) > 1 ) {
-          fc::http::header h;
-          char* end = line.data();
-          while( *end != ':' )++end;
-          h.key = fc::string(line.data(),end);
-          ++end; // skip ':'
-          ++end; // skip space
-          char* skey = end;
-          while( *end != '\r' ) ++end;
-          h.val = fc::string(skey,end);
-          rep.headers.push_back(h);
-          if( h.key == "Content-Length" ) {
-             rep.body.resize( static_cast<size_t>(to_uint64( fc::string(h.val) ) ));
-          }
+        while( true ) {
+          size_t n = body.readsome( chunk.data(), chunk.size() );
+          // the head goes out with the first chunk
+          out.write_chunk( chunk.data(), n, head_sent ? nullptr : &h );
+          head_sent = true;
         }
-        if( rep.body.size() ) {
-          sock.read( rep.body.data(), rep.body.size() );
+      } catch ( const fc::eof_exception& ) {}
+      if( !head_sent ) sock.write( head.c_str(), head.size() );
+      out.close();
+   }
+
+   /**
+    *  @param head_request the reply has no body whatever its headers say
+    *  @param out receives the body instead of reply::body if given
+    *  @throw on any error
+    */
+   fc::http::reply read_reply( bool head_request, fc::ostream* out = nullptr ) {
+      fc::http::reply rep;
+      size_t head_len = read_head( rep_parser );
+      rep.status = rep_parser.status();
+      head_info info = read_headers( rep_parser, rep.headers, rep.header_idx );
+      bool close = info.close || head_parser::str( buf.data(), rep_parser.version() ) == "HTTP/1.0";
+      buf.consume( head_len );
+      if( !head_request && rep.status >= 200 && rep.status != 204 && rep.status != 304 ) {
+        // a reply whose last transfer coding is not chunked ends with the connection
+        body_istream::framing_type f = info.chunked                                 ? body_istream::chunked :
+                                       info.has_length && !info.transfer_encoded ? body_istream::content_length :
+                                                                                   body_istream::until_eof;
+        // without either header the body is delimited by the end of the connection
+        if( f == body_istream::until_eof ) close = true;
+        body_istream in( buf, sock, f, info.length );
+        content_coding::type coding = decode_reply ? 
+                                        content_coding::parse( rep.get_header( header_id::content_encoding ) ) :
+                                        content_coding::identity;
+        if( coding == content_coding::identity ) {
+          if( out ) in.copy_to( *out ); 
+          else      in.read_all( rep.body, max_reply_body );
+        } else {
+          read_compressed( in, rep, out );
         }
-        return rep;
+      }
+      // the next request reconnects
+      if( close ) {
+        sock.close();
+        buf.clear();
+      }
+      return rep;
+   }
+
+   /**
+    *  Decompresses the body of rep from in, the reply then describes the decompressed
+    *  body, without Content-Encoding and Content-Length.
+    *  @throw out_of_range_exception if the decompressed body exceeds max_reply_body
+    */
+   void read_compressed( body_istream& in, fc::http::reply& rep, fc::ostream* out ) {
+      if( out ) {
+        inflate_istream   z( in );
+        std::vector<char> tmp( 64*1024 );
+        try {
+          while( true ) out->write( tmp.data(), z.readsome( tmp.data(), tmp.size() ) );
+        } catch ( const fc::eof_exception& ) {}
+      } else {
+        std::vector<char> compressed;
+        in.read_all( compressed, max_reply_body );
+        inflater z;
+        z.decompress( compressed.data(), compressed.size(), rep.body, max_reply_body );
+        if( !z.done() ) FC_THROW_EXCEPTION( parse_error_exception, "compressed body ended before its stream" );
+      }
+      for( size_t i = 0; i < rep.headers.size(); ) {
+        header_id::type id = header_id::lookup( rep.headers[i].key.c_str(), rep.headers[i].key.size() );
+        if( id == header_id::content_encoding || id == header_id::content_length ) rep.headers.erase( rep.headers.begin() + i );
+        else ++i;
+      }
+      rep.header_idx.clear();
+   }
+
+   fc::http::reply parse_reply() {
+      try {
+        return read_reply( false );
       } catch ( fc::exception& e ) {
         elog( "${exception}", ("exception",e.to_detail_string() ) );
         sock.close();
-        rep.status = http::reply::InternalServerError;
-        return rep;
+        buf.clear();
+        return fc::http::reply( http::reply::InternalServerError );
       } 
    }
 };
@@ -76,46 +251,34 @@ class fc::http::connection::impl
 namespace fc { namespace http {
 
          connection::connection()
-         :my( new connection::impl() ){}
+         :my( new connection::impl( std::make_shared<fc::tcp_socket>() ) ){}
+         connection::connection( const fc::tcp_socket_ptr& s )
+         :my( new connection::impl( s ) ){}
          connection::~connection(){}
 
 
 // used for clients
 void       connection::connect_to( const fc::ip::endpoint& ep ) {
   my->sock.close();
+  my->buf.clear();
   my->sock.connect_to( my->ep = ep );
 }
 
+void       connection::set_max_reply_body( uint64_t n ) {
+  my->max_reply_body = n;
+}
+
 http::reply connection::request( const fc::string& method, 
                                 const fc::string& url, 
                                 const fc::string& body, const headers& he ) {
 	
   if( !my->sock.is_open() ) {
     wlog( "Re-open socket!" );
+    my->buf.clear();
     my->sock.connect_to( my->ep );
   }
   try {
-      fc::stringstream req;
-      req << method <<" "<<url<<" HTTP/1.1\r\n";
-      req << "Host: localhost\r\n";
-      req << "Content-Type: application/json\r\n";
-      for( auto i = he.begin(); i != he.end(); ++i )
-      {
-          req << i->key <<": " << i->val<<"\r\n";
-      }
-      if( body.size() ) req << "Content-Length: "<< body.size() << "\r\n";
-      req << "\r\n"; 
-      fc::string head = req.str();
-
-      my->sock.write( head.c_str(), head.size() );
-    //  fc::cerr.write( head.c_str() );
-
-      if( body.size() )  {
-          my->sock.write( body.c_str(), body.size() );
-    //      fc::cerr.write( body.c_str() );
-      }
-    //  fc::cerr.flush();
-
+      my->write_request( method, url, fc::string(my->ep), body, he );
       return my->parse_reply();
   } catch ( ... ) {
       my->sock.close();
@@ -124,52 +287,86 @@ http::reply connection::request( const fc::string& method,
   }
 }
 
+http::reply connection::send_request( const fc::string& method, const fc::string& target, const fc::string& host,
+                                      const fc::string& body, const headers& he ) {
+  try {
+      my->write_request( method, target, host, body, he );
+      return my->read_reply( method == "HEAD" );
+  } catch ( ... ) {
+      my->sock.close();
+      my->buf.clear();
+      throw;
+  }
+}
+
+http::reply connection::send_request( const fc::string& method, const fc::string& target, const fc::string& host,
+                                      fc::istream* body, fc::ostream* reply_body, const headers& he ) {
+  try {
+      if( body ) my->write_request( method, target, host, *body, he );
+      else       my->write_request( method, target, host, fc::string(), he );
+      return my->read_reply( method == "HEAD", reply_body );
+  } catch ( ... ) {
+      my->sock.close();
+      my->buf.clear();
+      throw;
+  }
+}
+
 // used for servers
 fc::tcp_socket& connection::get_socket()const {
   return my->sock;
 }
 
 http::request    connection::read_request()const {
-  http::request req;
-  std::vector<char> line(1024*8);
-  int s = my->read_until( line.data(), line.data()+line.size(), ' ' ); // METHOD
-  req.method = line.data();
-  s = my->read_until( line.data(), line.data()+line.size(), ' ' ); // PATH
-  req.path = line.data();
-  s = my->read_until( line.data(), line.data()+line.size(), '\n' ); // HTTP/1.0
-  
-  while( (s = my->read_until( line.data(), line.data()+line.size(), '\n' )) > 1 ) {
-    fc::http::header h;
-    char* end = line.data();
-    while( *end != ':' )++end;
-    h.key = fc::string(line.data(),end);
-    ++end; // skip ':'
-    ++end; // skip space
-    char* skey = end;
-    while( *end != '\r' ) ++end;
-    h.val = fc::string(skey,end);
-    req.headers.push_back(h);
-    if( h.key == "Content-Length" ) {
-       req.body.resize( static_cast<size_t>(to_uint64( fc::string(h.val) ) ));
-    }
-    if( h.key == "Host" ) {
-       req.domain = h.val;
-    }
-  }
-  // TODO: some common servers won't give a Content-Length, they'll use 
-  // Transfer-Encoding: chunked.  handle that here.
+  return read_request( time_point::maximum() );
+}
+
+http::request    connection::read_request( const time_point& deadline )const {
+  http::request req = read_request_head( deadline );
+  my->req_body->read_all( req.body );
+  return req;
+}
 
-  if( req.body.size() ) {
-    my->sock.read( req.body.data(), req.body.size() );
+http::request    connection::read_request_head( const time_point& deadline )const {
+  if( my->req_body && !my->req_body->done() ) {
+    // the body of the previous request was not read
+    my->req_body->skip();
   }
+  my->req_body.reset();
+
+  http::request req;
+  size_t head_len = my->read_head( my->req_parser, deadline );
+  const char* d = my->buf.data();
+  req.method  = head_parser::str( d, my->req_parser.method() );
+  req.path    = head_parser::str( d, my->req_parser.target() );
+  req.version = head_parser::str( d, my->req_parser.version() );
+  impl::head_info info = my->read_headers( my->req_parser, req.headers, req.header_idx, &req.domain );
+  req.keep_alive = req.version == "HTTP/1.0" ? info.keep_alive : !info.close;
+  my->buf.consume( head_len );
+
+  // a request without either header has no body (RFC 7230 3.3.3)
+  if( info.chunked ) 
+    my->req_body = std::make_shared<body_istream>( my->buf, my->sock, body_istream::chunked );
+  else
+    my->req_body = std::make_shared<body_istream>( my->buf, my->sock, body_istream::content_length, info.length );
   return req;
 }
 
+std::shared_ptr<body_istream> connection::body_stream()const {
+  return my->req_body;
+}
+
 fc::string request::get_header( const fc::string& key )const {
-  for( auto itr = headers.begin(); itr != headers.end(); ++itr ) {
-    if( itr->key == key ) { return itr->val; } 
-  }
-  return fc::string();
+  return detail::header_value( headers, header_idx, key );
+}
+fc::string request::get_header( header_id::type id )const {
+  return detail::header_value( headers, header_idx, id );
+}
+fc::string reply::get_header( const fc::string& key )const {
+  return detail::header_value( headers, header_idx, key );
+}
+fc::string reply::get_header( header_id::type id )const {
+  return detail::header_value( headers, header_idx, id );
 }
 std::vector<header> parse_urlencoded_params( const fc::string& f ) {
   int num_args = 0;
@@ -0,0 +1,400 @@
+#include <fc/network/http/file_handler.hpp>
+#include <fc/network/http/compression.hpp>
+#include <fc/crypto/hex.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
+#include <unordered_map>
+#include <list>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fc { namespace http {
+
+  namespace detail {
+    /** tells a file from what it was before it was rewritten or replaced */
+    struct file_version {
+      file_version():size(0),mtime_ns(0),inode(0){}
+      uint64_t size;
+      uint64_t mtime_ns;
+      uint64_t inode;
+
+      bool operator==( const file_version& v )const { 
+        return size == v.size && mtime_ns == v.mtime_ns && inode == v.inode; 
+      }
+      bool operator!=( const file_version& v )const { return !(*this == v); }
+    };
+
+    file_version to_version( const struct stat& st ) {
+      file_version v;
+      v.size  = uint64_t(st.st_size);
+      v.inode = uint64_t(st.st_ino);
+#ifdef __APPLE__
+      v.mtime_ns = uint64_t(st.st_mtimespec.tv_sec) * 1000000000 + uint64_t(st.st_mtimespec.tv_nsec);
+#else
+      v.mtime_ns = uint64_t(st.st_mtim.tv_sec) * 1000000000 + uint64_t(st.st_mtim.tv_nsec);
+#endif
+      return v;
+    }
+
+    /** @return false if file is not a regular file */
+    bool stat_file( const fc::string& file, file_version& v ) {
+      struct stat st;
+      if( ::stat( file.c_str(), &st ) != 0 || !S_ISREG( st.st_mode ) ) return false;
+      v = to_version( st );
+      return true;
+    }
+
+    /**
+     *  A copy of a small file.  Copied rather than mapped, as a mapping of a file that 
+     *  is truncated meanwhile raises SIGBUS when the pages past its new end are read.
+     */
+    struct cached_file {
+      std::vector<char>  bytes;
+      file_version       version;
+
+      const char* data()const { return bytes.data(); }
+    };
+    typedef std::shared_ptr<cached_file> cached_file_ptr;
+
+    const char* content_type( const fc::string& ext ) {
+      static const struct { const char* ext; const char* type; } types[] = {
+        { ".html", "text/html; charset=utf-8" },
+        { ".htm",  "text/html; charset=utf-8" },
+        { ".css",  "text/css; charset=utf-8" },
+        { ".js",   "application/javascript" },
+        { ".json", "application/json" },
+        { ".txt",  "text/plain; charset=utf-8" },
+        { ".xml",  "application/xml" },
+        { ".svg",  "image/svg+xml" },
+        { ".png",  "image/png" },
+        { ".jpg",  "image/jpeg" },
+        { ".jpeg", "image/jpeg" },
+        { ".gif",  "image/gif" },
+        { ".ico",  "image/x-icon" },
+        { ".wasm", "application/wasm" },
+        { ".gz",   "application/gzip" }
+      };
+      for( size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i )
+        if( iequals( ext.c_str(), ext.size(), types[i].ext, strlen(types[i].ext) ) ) return types[i].type;
+      return "application/octet-stream";
+    }
+
+    bool etag_matches( const fc::string& v, const fc::string& etag ) {
+      size_t i = 0;
+      while( i < v.size() ) {
+        while( i < v.size() && (v[i] == ' ' || v[i] == '\t' || v[i] == ',') ) ++i;
+        size_t e = v.find( ',', i );
+        if( e == fc::string::npos ) e = v.size();
+        size_t te = e;
+        while( te > i && (v[te-1] == ' ' || v[te-1] == '\t') ) --te;
+        size_t b = i;
+        if( te - b >= 2 && v[b] == 'W' && v[b+1] == '/' ) b += 2;
+        if( (te - b == 1 && v[b] == '*') || v.compare( b, te - b, etag ) == 0 ) return true;
+        i = e;
+      }
+      return false;
+    }
+
+    range_result parse_range( const fc::string& v, uint64_t size, uint64_t& first, uint64_t& last ) {
+      const fc::string unit = "bytes=";
+      if( v.compare( 0, unit.size(), unit ) != 0 || v.find( ',' ) != fc::string::npos ) return no_range;
+      const char* p   = v.c_str() + unit.size();
+      const char* end = v.c_str() + v.size();
+      auto number = [&]( uint64_t& n ) -> bool {
+        const char* s = p;
+        n = 0;
+        while( p < end && *p >= '0' && *p <= '9' && p - s < 19 ) n = n * 10 + uint64_t(*p++ - '0');
+        return p > s;
+      };
+      uint64_t a = 0, b = 0;
+      bool has_a = number( a );
+      if( p == end || *p++ != '-' ) return no_range;
+      bool has_b = number( b );
+      if( p != end || (!has_a && !has_b) ) return no_range;
+      if( !has_a ) {
+        // the last b bytes
+        if( b == 0 || size == 0 ) return not_satisfiable;
+        first = b >= size ? 0 : size - b;
+        last  = size - 1;
+        return satisfiable;
+      }
+      if( has_b && b < a ) return no_range;
+      if( a >= size ) return not_satisfiable;
+      first = a;
+      last  = has_b && b < size ? b : size - 1;
+      return satisfiable;
+    }
+
+    fc::string to_hex_string( uint64_t v ) {
+      char tmp[17];
+      snprintf( tmp, sizeof(tmp), "%llx", (unsigned long long)v );
+      return tmp;
+    }
+  }
+
+  class file_handler::impl {
+    public:
+      impl( const fc::string& prefix, const fc::path& root )
+      :prefix(prefix),root(root),max_file(256*1024),max_total(64*1024*1024),precompressed(false),cached_bytes(0),
+       cache_hits(0),cache_misses(0),cache_evictions(0),sendfile_responses(0),not_modified(0),partial(0),
+       precompressed_responses(0) {
+        while( this->prefix.size() && this->prefix[this->prefix.size()-1] == '/' )
+          this->prefix.resize( this->prefix.size() - 1 );
+      }
+
+      /**
+       *  Maps the path of a request to a file under root.
+       *  @return false if the path is not under the prefix
+       *  @param file left empty if the path does not name a file that may be served
+       */
+      bool map_path( const fc::string& target, fc::path& file )const {
+        size_t end = target.find_first_of( "?#" );
+        if( end == fc::string::npos ) end = target.size();
+        if( target.compare( 0, prefix.size(), prefix ) != 0 ) return false;
+        if( end > prefix.size() && target[prefix.size()] != '/' ) return false;
+
+        fc::path   p = root;
+        fc::string segment;
+        for( size_t i = prefix.size(); i <= end; ++i ) {
+          if( i == end || target[i] == '/' ) {
+            // "." and empty segments are skipped, ".." may not leave root
+            if( segment == ".." ) return true;
+            if( segment.size() && segment != "." ) p /= segment;
+            segment.clear();
+          } else if( target[i] == '%' ) {
+            if( i + 2 >= end ) return true;
+            char c;
+            try {
+              c = char( (fc::from_hex( target[i+1] ) << 4) | fc::from_hex( target[i+2] ) );
+            } catch ( const fc::exception& ) {
+              return true;
+            }
+            if( c == '\0' || c == '/' || c == '\\' ) return true;
+            segment += c;
+            i += 2;
+          } else {
+            segment += target[i];
+          }
+        }
+        file = p;
+        return true;
+      }
+
+      /** 
+       *  Reads file unless it is no longer at version v.
+       *  @return null if it could not be read as it was at version v
+       */
+      static detail::cached_file_ptr read_file( const fc::string& file, const detail::file_version& v ) {
+        int fd = ::open( file.c_str(), O_RDONLY );
+        if( fd < 0 ) return detail::cached_file_ptr();
+        detail::cached_file_ptr f = std::make_shared<detail::cached_file>();
+        f->version = v;
+        f->bytes.resize( size_t(v.size) );
+        struct stat st;
+        bool   ok = ::fstat( fd, &st ) == 0 && detail::to_version( st ) == v;
+        size_t n  = 0;
+        while( ok && n < f->bytes.size() ) {
+          ssize_t r = ::read( fd, f->bytes.data() + n, f->bytes.size() - n );
+          if( r < 0 && errno == EINTR ) continue;
+          if( r <= 0 ) ok = false;
+          else         n += size_t(r);
+        }
+        // not rewritten while it was read
+        ok = ok && ::fstat( fd, &st ) == 0 && detail::to_version( st ) == v;
+        ::close( fd );
+        return ok ? f : detail::cached_file_ptr();
+      }
+
+      /** @return a copy of file at version v, from the cache if it has one */
+      detail::cached_file_ptr get_cached( const fc::path& file, const detail::file_version& v ) {
+        fc::string key = file.string();
+        {
+          boost::unique_lock<boost::mutex> lock( cache_mutex );
+          auto itr = cache.find( key );
+          if( itr != cache.end() && itr->second.first->version == v ) {
+            lru.splice( lru.begin(), lru, itr->second.second );
+            cache_hits.fetch_add( 1, boost::memory_order_relaxed );
+            return itr->second.first;
+          }
+        }
+        cache_misses.fetch_add( 1, boost::memory_order_relaxed );
+
+        // read without holding the lock, another thread may do the same meanwhile
+        detail::cached_file_ptr f = read_file( key, v );
+        if( !f ) return f;
+
+        boost::unique_lock<boost::mutex> lock( cache_mutex );
+        auto itr = cache.find( key );
+        if( itr != cache.end() ) {
+          cached_bytes -= itr->second.first->version.size;
+          lru.erase( itr->second.second );
+          cache.erase( itr );
+        }
+        lru.push_front( key );
+        cache[key] = std::make_pair( f, lru.begin() );
+        cached_bytes += v.size;
+        while( cached_bytes > max_total && lru.size() > 1 ) {
+          auto victim = cache.find( lru.back() );
+          cached_bytes -= victim->second.first->version.size;
+          cache.erase( victim );
+          lru.pop_back();
+          cache_evictions.fetch_add( 1, boost::memory_order_relaxed );
+        }
+        return f;
+      }
+
+      void send_status( const server::response& rep, reply::status_code s ) {
+        rep.set_status( s );
+        rep.set_length( 0 );
+        rep.write( nullptr, 0 );
+      }
+
+      void serve( const request& r, const server::response& rep, const fc::path& file ) {
+        if( r.method != "GET" && r.method != "HEAD" ) {
+          rep.add_header( "Allow", "GET, HEAD" );
+          send_status( rep, reply::MethodNotAllowed );
+          return;
+        }
+        detail::file_version v;
+        if( file == fc::path() || !detail::stat_file( file.string(), v ) ) {
+          send_status( rep, reply::NotFound );
+          return;
+        }
+
+        // the type is that of the original file either way
+        fc::string type = detail::content_type( file.extension().string() );
+        fc::path   sent = file;
+        bool       gz   = false;
+        if( precompressed ) {
+          fc::string           gzp = file.string() + ".gz";
+          detail::file_version gz_v;
+          if( detail::stat_file( gzp, gz_v ) && gz_v.mtime_ns >= v.mtime_ns ) {
+            rep.add_header( "Vary", "Accept-Encoding" );
+            if( gz_v.size && 
+                content_coding::negotiate( r.get_header( header_id::accept_encoding ) ) == content_coding::gzip ) {
+              gz   = true;
+              sent = gzp;
+              v    = gz_v;
+            }
+          }
+        }
+        uint64_t size = v.size;
+
+        fc::string etag = "\"" + detail::to_hex_string( v.size ) + "-" + detail::to_hex_string( v.mtime_ns ) + "-" +
+                          detail::to_hex_string( v.inode ) + (gz ? "-gz\"" : "\"");
+        rep.add_header( "ETag", etag );
+        // or the tag of the body the server compressed, see server::set_compression()
+        fc::string inm = r.get_header( header_id::if_none_match );
+        content_coding::type coding = gz ? content_coding::identity :
+                                      content_coding::negotiate( r.get_header( header_id::accept_encoding ) );
+        if( inm.size() && (detail::etag_matches( inm, etag ) || 
+                           (coding != content_coding::identity && 
+                            detail::etag_matches( inm, content_coding::tag( etag, coding ) ))) ) {
+          not_modified.fetch_add( 1, boost::memory_order_relaxed );
+          send_status( rep, reply::NotModified );
+          return;
+        }
+
+        rep.add_header( "Content-Type", type );
+        if( gz ) {
+          rep.add_header( "Content-Encoding", "gzip" );
+          precompressed_responses.fetch_add( 1, boost::memory_order_relaxed );
+        }
+        rep.add_header( "Accept-Ranges", "bytes" );
+
+        uint64_t first = 0, last = size ? size - 1 : 0;
+        fc::string range = r.get_header( header_id::range );
+        fc::string if_range = r.get_header( "If-Range" );
+        detail::range_result rr = range.size() && (if_range.empty() || if_range == etag) ?
+                                    detail::parse_range( range, size, first, last ) : detail::no_range;
+        if( rr == detail::not_satisfiable ) {
+          rep.add_header( "Content-Range", "bytes */" + fc::to_string( size ) );
+          send_status( rep, reply::RangeNotSatisfiable );
+          return;
+        }
+        uint64_t length = size;
+        if( rr == detail::satisfiable ) {
+          partial.fetch_add( 1, boost::memory_order_relaxed );
+          rep.add_header( "Content-Range", "bytes " + fc::to_string( first ) + "-" + fc::to_string( last ) +
+                                           "/" + fc::to_string( size ) );
+          rep.set_status( reply::PartialContent );
+          length = last - first + 1;
+        }
+
+        if( size <= max_file ) {
+          if( detail::cached_file_ptr f = get_cached( sent, v ) ) {
+            rep.set_length( length );
+            // with the head in one write
+            rep.write( length ? f->data() + first : nullptr, length );
+            return;
+          }
+        }
+        sendfile_responses.fetch_add( 1, boost::memory_order_relaxed );
+        rep.send_file( sent, first, length );
+      }
+
+      fc::string                                     prefix;
+      fc::path                                       root;
+      uint64_t                                       max_file;
+      uint64_t                                       max_total;
+      bool                                           precompressed;
+
+      mutable boost::mutex                           cache_mutex;
+      std::list<fc::string>                          lru;      ///< most recently used first
+      std::unordered_map<fc::string,
+                         std::pair<detail::cached_file_ptr, std::list<fc::string>::iterator> > cache;
+      uint64_t                                       cached_bytes;
+
+      boost::atomic<uint64_t>                        cache_hits;
+      boost::atomic<uint64_t>                        cache_misses;
+      boost::atomic<uint64_t>                        cache_evictions;
+      boost::atomic<uint64_t>                        sendfile_responses;
+      boost::atomic<uint64_t>                        not_modified;
+      boost::atomic<uint64_t>                        partial;
+      boost::atomic<uint64_t>                        precompressed_responses;
+  };
+
+  file_handler::file_handler( const fc::string& url_prefix, const fc::path& root )
+  :my( new impl( url_prefix, root ) ){}
+
+  file_handler::~file_handler(){}
+
+  void file_handler::set_cache_limits( uint64_t max_file, uint64_t max_total ) {
+    boost::unique_lock<boost::mutex> lock( my->cache_mutex );
+    my->max_file  = max_file;
+    my->max_total = max_total;
+  }
+
+  void file_handler::set_precompressed( bool on ) {
+    my->precompressed = on;
+  }
+
+  bool file_handler::handle( const request& r, const server::response& rep )const {
+    fc::path file;
+    if( !my->map_path( r.path, file ) ) return false;
+    my->serve( r, rep, file );
+    return true;
+  }
+
+  file_handler::stats file_handler::get_stats()const {
+    stats s;
+    s.cache_hits         = my->cache_hits.load( boost::memory_order_relaxed );
+    s.cache_misses       = my->cache_misses.load( boost::memory_order_relaxed );
+    s.cache_evictions    = my->cache_evictions.load( boost::memory_order_relaxed );
+    s.sendfile_responses = my->sendfile_responses.load( boost::memory_order_relaxed );
+    s.not_modified       = my->not_modified.load( boost::memory_order_relaxed );
+    s.partial            = my->partial.load( boost::memory_order_relaxed );
+    s.precompressed      = my->precompressed_responses.load( boost::memory_order_relaxed );
+    boost::unique_lock<boost::mutex> lock( my->cache_mutex );
+    s.cached_files       = my->lru.size();
+    s.cached_bytes       = my->cached_bytes;
+    return s;
+  }
+
+} } // fc::http
@@ -0,0 +1,85 @@
+#include <fc/network/http/header_index.hpp>
+#include <string.h>
+
+namespace fc { namespace http {
+
+  namespace detail {
+    inline char lower( char c ) { return c >= 'A' && c <= 'Z' ? char(c + ('a' - 'A')) : c; }
+
+    struct known_name {
+      const char*     name;
+      size_t          len;
+      header_id::type id;
+    };
+    #define FC_HTTP_KNOWN_HEADER( NAME, ID ) { NAME, sizeof(NAME) - 1, header_id::ID }
+    const known_name known_names[] = {
+      { "", 0, header_id::unknown },
+      FC_HTTP_KNOWN_HEADER( "Host",              host ),
+      FC_HTTP_KNOWN_HEADER( "Connection",        connection ),
+      FC_HTTP_KNOWN_HEADER( "Content-Length",    content_length ),
+      FC_HTTP_KNOWN_HEADER( "Content-Type",      content_type ),
+      FC_HTTP_KNOWN_HEADER( "Transfer-Encoding", transfer_encoding ),
+      FC_HTTP_KNOWN_HEADER( "Accept-Encoding",   accept_encoding ),
+      FC_HTTP_KNOWN_HEADER( "Content-Encoding",  content_encoding ),
+      FC_HTTP_KNOWN_HEADER( "Range",             range ),
+      FC_HTTP_KNOWN_HEADER( "If-None-Match",     if_none_match ),
+      FC_HTTP_KNOWN_HEADER( "If-Modified-Since", if_modified_since ),
+      FC_HTTP_KNOWN_HEADER( "ETag",              etag ),
+      FC_HTTP_KNOWN_HEADER( "Last-Modified",     last_modified ),
+      FC_HTTP_KNOWN_HEADER( "Expect",            expect )
+    };
+    #undef FC_HTTP_KNOWN_HEADER
+    static_assert( sizeof(known_names) / sizeof(known_names[0]) == header_id::count, "a known header has no name" );
+  }
+
+  bool iequals( const char* a, size_t alen, const char* b, size_t blen ) {
+    if( alen != blen ) return false;
+    for( size_t i = 0; i < alen; ++i )
+      if( detail::lower( a[i] ) != detail::lower( b[i] ) ) return false;
+    return true;
+  }
+
+  uint32_t header_hash( const char* name, size_t len ) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for( size_t i = 0; i < len; ++i ) {
+      h ^= uint8_t( detail::lower( name[i] ) );
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  namespace header_id {
+    type lookup( const char* n, size_t len ) {
+      // the lengths of the known names are almost all different, so names are rarely compared
+      for( uint32_t i = 1; i < count; ++i ) {
+        const detail::known_name& k = detail::known_names[i];
+        if( k.len == len && iequals( k.name, k.len, n, len ) ) return k.id;
+      }
+      return unknown;
+    }
+    const char* name( type id ) {
+      return detail::known_names[id].name;
+    }
+  }
+
+  const uint32_t header_index::npos;
+
+  header_index::header_index() {
+    clear();
+  }
+
+  void header_index::clear() {
+    for( uint32_t i = 0; i < header_id::count; ++i ) _known[i] = npos;
+    _hashes.clear();
+  }
+
+  header_id::type header_index::add( const char* name, size_t len ) {
+    uint32_t        n  = uint32_t(_hashes.size());
+    header_id::type id = header_id::lookup( name, len );
+    if( id != header_id::unknown && _known[id] == npos ) _known[id] = n;
+    _hashes.push_back( header_hash( name, len ) );
+    return id;
+  }
+
+} } // fc::http
@@ -0,0 +1,233 @@
+#include <fc/network/http/parser.hpp>
+#include <fc/io/iostream.hpp>
+#include <fc/exception/exception.hpp>
+#include <string.h>
+
+namespace fc { namespace http {
+
+  namespace detail {
+    uint64_t parse_content_length( const char* v, size_t len ) {
+      if( len == 0 || len > 19 ) FC_THROW_EXCEPTION( parse_error_exception, "invalid Content-Length" );
+      uint64_t r = 0;
+      for( size_t i = 0; i < len; ++i ) {
+        if( v[i] < '0' || v[i] > '9' ) FC_THROW_EXCEPTION( parse_error_exception, "invalid Content-Length" );
+        r = r * 10 + uint64_t(v[i] - '0');
+      }
+      return r;
+    }
+
+    /**
+     *  Follows the codings of a Transfer-Encoding value, in the order they were applied.
+     *  @param chunked incremented for every chunked coding
+     *  @param last_chunked whether the last coding so far is chunked
+     */
+    void scan_codings( const char* v, size_t len, uint32_t& chunked, bool& last_chunked ) {
+      const char* end = v + len;
+      while( v < end ) {
+        while( v < end && (*v == ' ' || *v == '\t' || *v == ',') ) ++v;
+        const char* e = v;
+        while( e < end && *e != ',' ) ++e;
+        // without its parameters
+        const char* te = v;
+        while( te < e && *te != ';' && *te != ' ' && *te != '\t' ) ++te;
+        if( te > v ) {
+          last_chunked = iequals( v, te - v, "chunked", 7 );
+          if( last_chunked ) ++chunked;
+        }
+        v = e;
+      }
+    }
+  }
+
+  read_buffer::read_buffer( size_t initial_capacity )
+  :_buf( initial_capacity ),_begin(0),_end(0){}
+
+  void read_buffer::consume( size_t n ) {
+    FC_ASSERT( n <= size() );
+    _begin += n;
+    if( _begin == _end ) _begin = _end = 0;
+  }
+
+  mutable_buffer read_buffer::prepare( size_t max_size ) {
+    if( _end == _buf.size() ) {
+      if( _begin > 0 ) {
+        memmove( _buf.data(), _buf.data() + _begin, _end - _begin );
+        _end  -= _begin;
+        _begin = 0;
+      } else {
+        if( _buf.size() >= max_size )
+          FC_THROW_EXCEPTION( parse_error_exception, "message exceeds ${max} bytes", ("max", uint64_t(max_size)) );
+        _buf.resize( (std::min)( _buf.size() * 2, max_size ) );
+      }
+    }
+    return mutable_buffer( _buf.data() + _end, _buf.size() - _end );
+  }
+
+  void read_buffer::commit( size_t n ) {
+    FC_ASSERT( _end + n <= _buf.size() );
+    _end += n;
+  }
+
+  size_t read_buffer::fill( istream& s, size_t max_size ) {
+    mutable_buffer b = prepare( max_size );
+    size_t r = s.readsome( b.data, b.size );
+    commit( r );
+    return r;
+  }
+
+  void read_buffer::read( istream& s, char* out, size_t len ) {
+    size_t n = (std::min)( len, size() );
+    memcpy( out, data(), n );
+    consume( n );
+    if( len > n ) s.read( out + n, len - n );
+  }
+
+
+  head_parser::head_parser( message_type t, size_t max_head_size, size_t max_headers )
+  :_type(t),_max_head_size(max_head_size),_max_headers(max_headers) {
+    reset();
+  }
+
+  void head_parser::reset() {
+    _pos        = 0;
+    _data       = nullptr;
+    _have_first = false;
+    _complete   = false;
+    _first = _second = _third = field();
+    _status     = 0;
+    _headers.clear();
+    _index.clear();
+  }
+
+  size_t head_parser::parse( const char* data, size_t size ) {
+    if( _complete ) return _pos;
+    _data = data;
+    while( _pos < size ) {
+      const char* line = data + _pos;
+      const char* nl   = (const char*)memchr( line, '\n', size - _pos );
+      if( !nl ) break;
+      size_t len = nl - line;
+      if( len && line[len-1] == '\r' ) --len;
+      _pos = nl - data + 1;
+
+      if( !_have_first ) {
+        // empty lines before the request line are ignored (RFC 7230 3.5)
+        if( len == 0 ) continue;
+        parse_first_line( line, len );
+        _have_first = true;
+      } else if( len == 0 ) {
+        _complete = true;
+        return _pos;
+      } else {
+        parse_header( line, len );
+      }
+    }
+    if( size >= _max_head_size )
+      FC_THROW_EXCEPTION( parse_error_exception, "message head exceeds ${max} bytes", ("max", uint64_t(_max_head_size)) );
+    return 0;
+  }
+
+  head_parser::field head_parser::make_field( const char* data, const char* b, const char* e )const {
+    field f;
+    f.offset = uint32_t(b - data);
+    f.length = uint32_t(e - b);
+    return f;
+  }
+
+  void head_parser::parse_first_line( const char* line, size_t len ) {
+    const char* end = line + len;
+    const char* sp1 = (const char*)memchr( line, ' ', len );
+    if( !sp1 || sp1 == line )
+      FC_THROW_EXCEPTION( parse_error_exception, "malformed start line" );
+    const char* second = sp1 + 1;
+    const char* sp2    = (const char*)memchr( second, ' ', end - second );
+
+    if( _type == request_head ) {
+      // METHOD SP request-target SP HTTP-version
+      if( !sp2 || sp2 == second || end - (sp2+1) < 5 || memcmp( sp2+1, "HTTP/", 5 ) != 0 )
+        FC_THROW_EXCEPTION( parse_error_exception, "malformed request line" );
+      _first  = make_field( _data, line, sp1 );
+      _second = make_field( _data, second, sp2 );
+      _third  = make_field( _data, sp2+1, end );
+      return;
+    }
+
+    // HTTP-version SP status-code SP reason-phrase, the reason may be missing
+    if( sp1 - line < 5 || memcmp( line, "HTTP/", 5 ) != 0 )
+      FC_THROW_EXCEPTION( parse_error_exception, "malformed status line" );
+    const char* code_end = sp2 ? sp2 : end;
+    if( code_end - second != 3 )
+      FC_THROW_EXCEPTION( parse_error_exception, "malformed status code" );
+    _status = 0;
+    for( const char* c = second; c < code_end; ++c ) {
+      if( *c < '0' || *c > '9' )
+        FC_THROW_EXCEPTION( parse_error_exception, "malformed status code" );
+      _status = _status * 10 + (*c - '0');
+    }
+    _first  = make_field( _data, line, sp1 );
+    _second = make_field( _data, second, code_end );
+    _third  = sp2 ? make_field( _data, sp2+1, end ) : make_field( _data, end, end );
+  }
+
+  void head_parser::parse_header( const char* line, size_t len ) {
+    if( _headers.size() >= _max_headers )
+      FC_THROW_EXCEPTION( parse_error_exception, "more than ${max} header fields", ("max", uint64_t(_max_headers)) );
+    // obsolete line folding is rejected (RFC 7230 3.2.4)
+    if( line[0] == ' ' || line[0] == '\t' )
+      FC_THROW_EXCEPTION( parse_error_exception, "folded header field" );
+    const char* end   = line + len;
+    const char* colon = (const char*)memchr( line, ':', len );
+    if( !colon || colon == line )
+      FC_THROW_EXCEPTION( parse_error_exception, "malformed header field" );
+    for( const char* c = line; c < colon; ++c )
+      if( *c == ' ' || *c == '\t' )
+        FC_THROW_EXCEPTION( parse_error_exception, "whitespace in header field name" );
+
+    const char* v = colon + 1;
+    while( v < end && (*v == ' ' || *v == '\t') ) ++v;
+    const char* ve = end;
+    while( ve > v && (ve[-1] == ' ' || ve[-1] == '\t') ) --ve;
+
+    header_field h;
+    h.key = make_field( _data, line, colon );
+    h.val = make_field( _data, v, ve );
+    h.id  = _index.add( line, colon - line );
+    _headers.push_back( h );
+  }
+
+  const head_parser::header_field* head_parser::find( const char* data, const char* name, size_t len )const {
+    uint32_t i = _index.find( name, len, [&]( uint32_t n ) { 
+      return const_buffer( data + _headers[n].key.offset, _headers[n].key.length ); 
+    } );
+    return i == header_index::npos ? nullptr : &_headers[i];
+  }
+
+  head_parser::framing head_parser::body_framing( const char* data )const {
+    framing  f;
+    uint32_t chunked      = 0;
+    bool     last_chunked = false;
+    // every field counts, so that no one looking at another one frames the body differently
+    for( size_t i = 0; i < _headers.size(); ++i ) {
+      const header_field& h = _headers[i];
+      if( h.id == header_id::content_length ) {
+        uint64_t l = detail::parse_content_length( data + h.val.offset, h.val.length );
+        if( f.has_length && l != f.length )
+          FC_THROW_EXCEPTION( parse_error_exception, "conflicting Content-Length fields" );
+        f.length     = l;
+        f.has_length = true;
+      } else if( h.id == header_id::transfer_encoding ) {
+        f.transfer_encoded = true;
+        detail::scan_codings( data + h.val.offset, h.val.length, chunked, last_chunked );
+      }
+    }
+    f.chunked = last_chunked && chunked == 1;
+    if( _type == request_head && f.transfer_encoded ) {
+      if( !f.chunked )
+        FC_THROW_EXCEPTION( parse_error_exception, "the last transfer coding of a request must be chunked" );
+      if( f.has_length )
+        FC_THROW_EXCEPTION( parse_error_exception, "a request has both Transfer-Encoding and Content-Length" );
+    }
+    return f;
+  }
+
+} } // fc::http
@@ -0,0 +1,294 @@
+#include <fc/network/http/router.hpp>
+#include <fc/exception/exception.hpp>
+#include <string.h>
+
+namespace fc { namespace http {
+
+  namespace detail {
+    int hex_value( char c ) {
+      if( c >= '0' && c <= '9' ) return c - '0';
+      if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+      if( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+      return -1;
+    }
+
+    /** percent decodes len bytes of s, invalid escapes are kept as they are */
+    fc::string url_decode( const char* s, size_t len, bool plus_is_space ) {
+      fc::string r;
+      r.reserve( len );
+      for( size_t i = 0; i < len; ++i ) {
+        int h, l;
+        if( s[i] == '%' && i + 2 < len && (h = hex_value( s[i+1] )) >= 0 && (l = hex_value( s[i+2] )) >= 0 ) {
+          r += char( (h << 4) | l );
+          i += 2;
+        } else if( s[i] == '+' && plus_is_space ) {
+          r += ' ';
+        } else {
+          r += s[i];
+        }
+      }
+      return r;
+    }
+
+    /**
+     *  A node of the trie matches prefix, then one of its children.  The static
+     *  children start with different characters, a capture matches up to the next '/'
+     *  and a wildcard the rest of the path.
+     */
+    struct route_node {
+      fc::string                                   prefix;
+      std::vector<std::unique_ptr<route_node> >    children;
+      /** set on the node that follows a ":name" */
+      std::unique_ptr<route_node>                  capture;
+      fc::string                                   capture_name;
+      /** a "*name" node, which has no children */
+      std::unique_ptr<route_node>                  rest;
+      fc::string                                   rest_name;
+      /** of the routes that end here, by method */
+      std::vector<std::pair<fc::string, router::handler> > handlers;
+
+      route_node* child( char c )const {
+        for( size_t i = 0; i < children.size(); ++i )
+          if( children[i]->prefix[0] == c ) return children[i].get();
+        return nullptr;
+      }
+
+      const router::handler* find_handler( const fc::string& method )const {
+        const router::handler* any = nullptr;
+        for( size_t i = 0; i < handlers.size(); ++i ) {
+          if( handlers[i].first == method ) return &handlers[i].second;
+          if( handlers[i].first == "*" ) any = &handlers[i].second;
+        }
+        if( !any && method == "HEAD" ) return find_handler( "GET" );
+        return any;
+      }
+    };
+  }
+
+  router::params::params()
+  :_query_parsed(false){}
+
+  fc::string router::params::get( const fc::string& name )const {
+    for( size_t i = 0; i < _path.size(); ++i )
+      if( _path[i].key == name ) return _path[i].val;
+    return fc::string();
+  }
+  bool router::params::has( const fc::string& name )const {
+    for( size_t i = 0; i < _path.size(); ++i )
+      if( _path[i].key == name ) return true;
+    return false;
+  }
+
+  const std::vector<header>& router::params::query_params()const {
+    if( _query_parsed ) return _query_params;
+    _query_parsed = true;
+    const char* q   = _query.c_str();
+    const char* end = q + _query.size();
+    while( q < end ) {
+      const char* e = (const char*)memchr( q, '&', end - q );
+      if( !e ) e = end;
+      if( e > q ) {
+        const char* eq = (const char*)memchr( q, '=', e - q );
+        if( eq ) _query_params.push_back( header( detail::url_decode( q, eq - q, true ),
+                                                  detail::url_decode( eq + 1, e - eq - 1, true ) ) );
+        else     _query_params.push_back( header( detail::url_decode( q, e - q, true ), fc::string() ) );
+      }
+      q = e + 1;
+    }
+    return _query_params;
+  }
+  fc::string router::params::query( const fc::string& name )const {
+    const std::vector<header>& qp = query_params();
+    for( size_t i = 0; i < qp.size(); ++i )
+      if( qp[i].key == name ) return qp[i].val;
+    return fc::string();
+  }
+
+
+  class router::impl {
+    public:
+      /** ':' and '*' elsewhere than at the start of a segment are matched as they are */
+      static bool is_capture( const fc::string& tmpl, size_t t ) {
+        return (tmpl[t] == ':' || tmpl[t] == '*') && t > 0 && tmpl[t-1] == '/';
+      }
+
+      /** adds the rest of a template, starting at t, below n */
+      void insert( detail::route_node* n, const fc::string& tmpl, size_t t, const fc::string& method, const handler& h ) {
+        while( t < tmpl.size() ) {
+          char c = tmpl[t];
+          if( is_capture( tmpl, t ) ) {
+            size_t e = tmpl.find( '/', t );
+            if( e == fc::string::npos ) e = tmpl.size();
+            fc::string name = tmpl.substr( t + 1, e - t - 1 );
+            if( name.empty() )
+              FC_THROW_EXCEPTION( invalid_arg_exception, "a capture of ${t} has no name", ("t",tmpl) );
+            if( c == '*' ) {
+              if( e != tmpl.size() )
+                FC_THROW_EXCEPTION( invalid_arg_exception, "*${n} must end ${t}", ("n",name)("t",tmpl) );
+              if( !n->rest ) {
+                n->rest.reset( new detail::route_node() );
+                n->rest_name = name;
+              } else if( n->rest_name != name ) {
+                FC_THROW_EXCEPTION( invalid_arg_exception, "*${n} of ${t} conflicts with *${o}",
+                                    ("n",name)("t",tmpl)("o",n->rest_name) );
+              }
+              n = n->rest.get();
+            } else {
+              if( !n->capture ) {
+                n->capture.reset( new detail::route_node() );
+                n->capture_name = name;
+              } else if( n->capture_name != name ) {
+                FC_THROW_EXCEPTION( invalid_arg_exception, ":${n} of ${t} conflicts with :${o}",
+                                    ("n",name)("t",tmpl)("o",n->capture_name) );
+              }
+              n = n->capture.get();
+            }
+            t = e;
+            continue;
+          }
+
+          // the static text up to the next capture
+          size_t e = t + 1;
+          while( e < tmpl.size() && !is_capture( tmpl, e ) ) ++e;
+          detail::route_node* ch = n->child( c );
+          if( !ch ) {
+            std::unique_ptr<detail::route_node> nn( new detail::route_node() );
+            nn->prefix = tmpl.substr( t, e - t );
+            ch = nn.get();
+            n->children.push_back( std::move( nn ) );
+            n = ch;
+            t = e;
+            continue;
+          }
+          size_t l = 0;
+          while( l < ch->prefix.size() && t + l < e && ch->prefix[l] == tmpl[t+l] ) ++l;
+          if( l < ch->prefix.size() ) {
+            // split ch where the template leaves its prefix
+            std::unique_ptr<detail::route_node> split( new detail::route_node() );
+            split->prefix = ch->prefix.substr( 0, l );
+            for( size_t i = 0; i < n->children.size(); ++i ) {
+              if( n->children[i].get() == ch ) {
+                ch->prefix = ch->prefix.substr( l );
+                split->children.push_back( std::move( n->children[i] ) );
+                n->children[i] = std::move( split );
+                ch = n->children[i].get();
+                break;
+              }
+            }
+          }
+          n = ch;
+          t += l;
+        }
+        for( size_t i = 0; i < n->handlers.size(); ++i ) {
+          if( n->handlers[i].first == method )
+            FC_THROW_EXCEPTION( invalid_arg_exception, "${m} ${t} is already routed", ("m",method)("t",tmpl) );
+        }
+        n->handlers.push_back( std::make_pair( method, h ) );
+      }
+
+      /** 
+       *  @return the handler of the route of method at n, else remembers n in other if it 
+       *          has routes of other methods
+       */
+      static const handler* at( const detail::route_node* n, const fc::string& method, 
+                                const detail::route_node*& other ) {
+        if( n->handlers.empty() ) return nullptr;
+        if( const handler* h = n->find_handler( method ) ) return h;
+        if( !other ) other = n;
+        return nullptr;
+      }
+
+      /**
+       *  Tries the static children first, then the capture, then the wildcard, so a path
+       *  matched by a route of another method may still find one of method further on.
+       *  @return the handler of the route of method matching the path from p on
+       *  @param other set to the first node matching the path, if no route of method does
+       */
+      const handler* match( const detail::route_node* n, const char* p, const char* end, const fc::string& method,
+                            std::vector<header>& caps, const detail::route_node*& other )const {
+        if( p == end ) {
+          if( const handler* h = at( n, method, other ) ) return h;
+        } else {
+          if( const detail::route_node* ch = n->child( *p ) ) {
+            size_t len = ch->prefix.size();
+            if( size_t(end - p) >= len && memcmp( p, ch->prefix.c_str(), len ) == 0 ) {
+              if( const handler* h = match( ch, p + len, end, method, caps, other ) ) return h;
+            }
+          }
+          if( n->capture && *p != '/' ) {
+            const char* e = (const char*)memchr( p, '/', end - p );
+            if( !e ) e = end;
+            caps.push_back( header( n->capture_name, detail::url_decode( p, e - p, false ) ) );
+            if( const handler* h = match( n->capture.get(), e, end, method, caps, other ) ) return h;
+            caps.pop_back();
+          }
+        }
+        if( n->rest ) {
+          caps.push_back( header( n->rest_name, detail::url_decode( p, end - p, false ) ) );
+          if( const handler* h = at( n->rest.get(), method, other ) ) return h;
+          caps.pop_back();
+        }
+        return nullptr;
+      }
+
+      const handler* match( const fc::string& path, const fc::string& method, std::vector<header>& caps,
+                            const detail::route_node*& other )const {
+        size_t e = path.find_first_of( "?#" );
+        if( e == fc::string::npos ) e = path.size();
+        return match( &root, path.c_str(), path.c_str() + e, method, caps, other );
+      }
+
+      detail::route_node root;
+      handler            not_found;
+  };
+
+  router::router()
+  :my( new impl() ){}
+
+  router::~router(){}
+
+  void router::add( const fc::string& method, const fc::string& path_template, const handler& h ) {
+    if( path_template.empty() || path_template[0] != '/' )
+      FC_THROW_EXCEPTION( invalid_arg_exception, "${t} does not start with '/'", ("t",path_template) );
+    my->insert( &my->root, path_template, 0, method, h );
+  }
+
+  void router::set_not_found( const handler& h ) {
+    my->not_found = h;
+  }
+
+  const router::handler* router::find( const fc::string& method, const fc::string& path, params& p )const {
+    const detail::route_node* other = nullptr;
+    return my->match( path, method, p._path, other );
+  }
+
+  void router::dispatch( const request& r, const server::response& rep )const {
+    params p;
+    size_t q = r.path.find( '?' );
+    if( q != fc::string::npos ) {
+      size_t e = r.path.find( '#', q );
+      p._query = r.path.substr( q + 1, e == fc::string::npos ? fc::string::npos : e - q - 1 );
+    }
+    const detail::route_node* other = nullptr;
+    if( const handler* h = my->match( r.path, r.method, p._path, other ) ) {
+      (*h)( r, rep, p );
+      return;
+    }
+    if( my->not_found ) {
+      my->not_found( r, rep, p );
+      return;
+    }
+    if( other ) {
+      fc::string allow;
+      for( size_t i = 0; i < other->handlers.size(); ++i )
+        allow += (i ? ", " : "") + other->handlers[i].first;
+      rep.add_header( "Allow", allow );
+      rep.set_status( reply::MethodNotAllowed );
+    } else {
+      rep.set_status( reply::NotFound );
+    }
+    rep.set_length( 0 );
+    rep.write( nullptr, 0 );
+  }
+
+} } // fc::http
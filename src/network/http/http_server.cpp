@@ -1,91 +1,522 @@
 #include <fc/network/http/server.hpp>
+#include <fc/network/http/body_stream.hpp>
+#include <fc/network/http/compression.hpp>
 #include <fc/thread/thread.hpp>
 #include <fc/network/tcp_socket.hpp>
-#include <fc/io/sstream.hpp>
-#include <fc/io/stdio.hpp>
+#include <fc/network/tcp_server_pool.hpp>
+#include <fc/filesystem.hpp>
 #include <fc/log/logger.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <boost/atomic.hpp>
 
 
 namespace fc { namespace http {
 
+  namespace detail {
+    struct status_line {
+      int         code;
+      const char* line;
+      size_t      len;
+    };
+    #define FC_HTTP_STATUS_LINE( CODE, REASON ) \
+      { CODE, "HTTP/1.1 " #CODE " " REASON "\r\n", sizeof("HTTP/1.1 " #CODE " " REASON "\r\n") - 1 }
+    /** sorted by code */
+    const status_line status_lines[] = {
+      FC_HTTP_STATUS_LINE( 100, "Continue" ),
+      FC_HTTP_STATUS_LINE( 101, "Switching Protocols" ),
+      FC_HTTP_STATUS_LINE( 200, "OK" ),
+      FC_HTTP_STATUS_LINE( 201, "Record Created" ),
+      FC_HTTP_STATUS_LINE( 202, "Accepted" ),
+      FC_HTTP_STATUS_LINE( 204, "No Content" ),
+      FC_HTTP_STATUS_LINE( 206, "Partial Content" ),
+      FC_HTTP_STATUS_LINE( 301, "Moved Permanently" ),
+      FC_HTTP_STATUS_LINE( 302, "Found" ),
+      FC_HTTP_STATUS_LINE( 304, "Not Modified" ),
+      FC_HTTP_STATUS_LINE( 400, "Bad Request" ),
+      FC_HTTP_STATUS_LINE( 401, "Unauthorized" ),
+      FC_HTTP_STATUS_LINE( 403, "Forbidden" ),
+      FC_HTTP_STATUS_LINE( 404, "Not Found" ),
+      FC_HTTP_STATUS_LINE( 405, "Method Not Allowed" ),
+      FC_HTTP_STATUS_LINE( 408, "Request Timeout" ),
+      FC_HTTP_STATUS_LINE( 411, "Length Required" ),
+      FC_HTTP_STATUS_LINE( 413, "Payload Too Large" ),
+      FC_HTTP_STATUS_LINE( 416, "Range Not Satisfiable" ),
+      FC_HTTP_STATUS_LINE( 500, "Internal Server Error" ),
+      FC_HTTP_STATUS_LINE( 501, "Not Implemented" ),
+      FC_HTTP_STATUS_LINE( 503, "Service Unavailable" )
+    };
+    #undef FC_HTTP_STATUS_LINE
+
+    void append( std::vector<char>& b, const char* s, size_t len ) {
+      b.insert( b.end(), s, s + len );
+    }
+    template<size_t N>
+    void append( std::vector<char>& b, const char (&s)[N] ) {
+      append( b, s, N - 1 );
+    }
+    void append( std::vector<char>& b, const fc::string& s ) {
+      append( b, s.c_str(), s.size() );
+    }
+    void append( std::vector<char>& b, uint64_t v ) {
+      char  tmp[20];
+      char* e = tmp + sizeof(tmp);
+      char* p = e;
+      do { *--p = char('0' + v % 10); v /= 10; } while( v );
+      append( b, p, e - p );
+    }
+
+    void append_status_line( std::vector<char>& b, int code ) {
+      const status_line* end = status_lines + sizeof(status_lines) / sizeof(status_lines[0]);
+      const status_line* l   = std::lower_bound( status_lines, end, code, 
+                                  []( const status_line& a, int c ) { return a.code < c; } );
+      if( l != end && l->code == code ) {
+        append( b, l->line, l->len );
+      } else {
+        // the reason phrase may be empty
+        append( b, "HTTP/1.1 " );
+        append( b, uint64_t(code) );
+        append( b, " \r\n" );
+      }
+    }
+  }
+
   class server::response::impl : public fc::retainable
   {
     public:
-      impl( const fc::http::connection_ptr& c, const std::function<void()>& cont = std::function<void()>() )
-      :body_bytes_sent(0),body_length(0),con(c),handle_next_req(cont)
+      /** @param head_buf reused by the responses of the connection to format their heads */
+      impl( const fc::http::connection_ptr& c, bool keep, bool http11, 
+            const std::shared_ptr<std::vector<char> >& head_buf )
+      :body_bytes_sent(0),body_length(0),has_length(false),headers_sent(false),con(c),keep_alive(keep),
+       http11(http11),head_request(false),head_buf(head_buf),compress_min(uint64_t(-1)),compress_level(6),
+       coding(content_coding::identity),done( new fc::promise<bool>("http::server::response") ),access_log(nullptr)
       {}
+      ~impl() {
+        if( !done->ready() )
+          done->set_exception( fc::exception_ptr( new fc::canceled_exception( 
+                               FC_LOG_MESSAGE( warn, "response released before its body was written" ) ) ) );
+      }
 
-      void send_header() {
-         fc::stringstream ss;
-         ss << "HTTP/1.1 " << rep.status << " ";
-         switch( rep.status ) {
-            case fc::http::reply::OK: ss << "OK\n\r"; break;
-            case fc::http::reply::RecordCreated: ss << "Record Created\n\r"; break;
-            case fc::http::reply::NotFound: ss << "Not Found\n\r"; break;
-            case fc::http::reply::Found: ss << "Found\n\r"; break;
-            case fc::http::reply::InternalServerError: ss << "Internal Server Error\r\n"; break;
-         }
+      enum framing_type { content_length, chunked, until_close };
+
+      /** 
+       *  formats the status line and header fields into head_buf 
+       *  @param length of a content_length body
+       */
+      const_buffer format_head( framing_type f, uint64_t length = 0 ) {
+         std::vector<char>& b = *head_buf;
+         b.clear();
+         detail::append_status_line( b, rep.status );
          for( uint32_t i = 0; i < rep.headers.size(); ++i ) {
-            ss << rep.headers[i].key <<": "<<rep.headers[i].val <<"\r\n";
+            detail::append( b, rep.headers[i].key );
+            detail::append( b, ": " );
+            detail::append( b, rep.headers[i].val );
+            detail::append( b, "\r\n" );
+         }
+         if( keep_alive ) detail::append( b, "Connection: keep-alive\r\n" );
+         else             detail::append( b, "Connection: close\r\n" );
+         if( rep.status < 200 || rep.status == reply::NoContent || rep.status == reply::NotModified ) {
+            // 1xx and 204 have no body, a 304 would have to repeat the length of the body it stands for
+         } else if( f == content_length ) {
+            detail::append( b, "Content-Length: " );
+            detail::append( b, length );
+            detail::append( b, "\r\n" );
+         } else if( f == chunked ) {
+            detail::append( b, "Transfer-Encoding: chunked\r\n" );
+         }
+         detail::append( b, "\r\n" );
+         return const_buffer( b.data(), b.size() );
+      }
+
+      /** sends the header followed by the first len bytes of the body with one write */
+      void send_header( const char* data, size_t len ) {
+         const_buffer h;
+         if( head_request ) {
+           // describes the body a GET would get, which is not sent
+           h = format_head( has_length || len == 0 ? content_length : http11 ? chunked : until_close, body_length );
+           con->get_socket().writev( &h, 1 );
+           headers_sent = true;
+           return;
+         }
+         if( has_length || len == 0 ) {
+           h = format_head( content_length, body_length );
+         } else if( http11 ) {
+           h = format_head( chunked );
+           chunks.reset( new chunked_ostream( con->get_socket() ) );
+           chunks->write_chunk( data, len, &h );
+           headers_sent = true;
+           return;
+         } else {
+           // the end of the connection ends the body
+           keep_alive = false;
+           h = format_head( until_close );
          }
-         ss << "Content-Length: "<<body_length<<"\r\n\r\n";
-         auto s = ss.str();
-         fc::cerr<<s<<"\n";
-         con->get_socket().write( s.c_str(), s.size() );
+         const_buffer bufs[2] = { h, const_buffer( data, len ) };
+         con->get_socket().writev( bufs, len ? 2 : 1 );
+         headers_sent = true;
       }
 
-      http::reply           rep;
-      int64_t               body_bytes_sent;
-      uint64_t              body_length;
-      http::connection_ptr      con;
-      std::function<void()> handle_next_req;
+      /** 
+       *  Decides whether to compress the body before the first of it is written, once the
+       *  handler has set the status and headers.  
+       *  @return true if the body is compressed with z
+       */
+      bool start_compression() {
+         if( rep.status < 200 || rep.status == reply::NoContent || rep.status == reply::PartialContent ||
+             rep.status == reply::NotModified || rep.get_header( header_id::content_encoding ).size() ||
+             !is_compressible_type( rep.get_header( header_id::content_type ) ) ||
+             (has_length && body_length < compress_min) ) {
+           return false;
+         }
+         // caches must not hand the compressed body to clients that did not ask for it
+         rep.headers.push_back( header( "Vary", "Accept-Encoding" ) );
+         if( coding == content_coding::identity ) return false;
+         rep.headers.push_back( header( "Content-Encoding", content_coding::name( coding ) ) );
+         // the compressed body differs from the one the tag was given to
+         for( size_t i = 0; i < rep.headers.size(); ++i ) {
+           if( iequals( rep.headers[i].key.c_str(), rep.headers[i].key.size(), "ETag", 4 ) ) {
+             rep.headers[i].val = content_coding::tag( rep.headers[i].val, coding );
+           }
+         }
+         z.reset( new deflater( coding, compress_level ) );
+         return true;
+      }
+
+      /** 
+       *  Compresses the next len bytes of the body and sends what zlib lets go of.  The
+       *  head goes out with the first of them, with a length only if last is set then.
+       *  @param last ends the body
+       */
+      void send_compressed( const char* data, size_t len, bool last ) {
+         zbuf.clear();
+         // flushed on every write so a streamed body is not held back
+         z->compress( data, len, zbuf, last ? deflater::finish : deflater::sync_flush );
+         if( !headers_sent ) {
+           const_buffer h;
+           if( last ) {
+             h = format_head( content_length, zbuf.size() );
+           } else if( http11 ) {
+             h = format_head( chunked );
+             chunks.reset( new chunked_ostream( con->get_socket() ) );
+             chunks->write_chunk( zbuf.data(), zbuf.size(), &h );
+             headers_sent = true;
+             return;
+           } else {
+             keep_alive = false;
+             h = format_head( until_close );
+           }
+           const_buffer bufs[2] = { h, const_buffer( zbuf.data(), zbuf.size() ) };
+           con->get_socket().writev( bufs, 2 );
+           headers_sent = true;
+         } else if( chunks ) {
+           if( zbuf.size() ) chunks->write_chunk( zbuf.data(), zbuf.size() );
+           if( last ) chunks->close();
+         } else if( zbuf.size() ) {
+           con->get_socket().write( zbuf.data(), zbuf.size() );
+         }
+      }
+
+      /** ends a body without a length */
+      void finish() {
+         if( done->ready() ) return;
+         if( z )                 send_compressed( nullptr, 0, true );
+         else if( !headers_sent ) send_header( nullptr, 0 );
+         else if( chunks )   chunks->close();
+         complete();
+      }
+
+      /** the whole body has been written */
+      void complete() {
+         if( access_log != nullptr ) {
+           fc_ilog( access_log, "${method} ${path} ${status} ${bytes} ${us}us",
+                    ("method",method)("path",path)("status",rep.status)("bytes",body_bytes_sent)
+                    ("us",(fc::time_point::now() - start).count()) );
+         }
+         done->set_value( keep_alive );
+      }
+
+      http::reply                          rep;
+      int64_t                              body_bytes_sent;
+      uint64_t                             body_length;
+      bool                                 has_length;
+      bool                                 headers_sent;
+      http::connection_ptr                 con;
+      bool                                 keep_alive;
+      bool                                 http11;
+      /** the body is counted but not sent */
+      bool                                 head_request;
+      /** shared by the responses of a connection */
+      std::shared_ptr<std::vector<char> >  head_buf;
+      /** set when the body is chunked */
+      std::unique_ptr<chunked_ostream>     chunks;
+
+      /// compression of the body, see server::set_compression()
+      /// @{
+      uint64_t                             compress_min;
+      int                                  compress_level;
+      /** negotiated with the client */
+      content_coding::type                 coding;
+      /** set when the body is compressed */
+      std::unique_ptr<deflater>            z;
+      std::vector<char>                    zbuf;
+      /// @}
+      /** 
+       *  Set to whether the connection may be kept alive once the whole body has been
+       *  written, or failed to be 
+       */
+      fc::promise<bool>::ptr               done;
+
+      /// for the access log
+      /// @{
+      fc::logger                           access_log;
+      fc::string                           method;
+      fc::string                           path;
+      fc::time_point                       start;
+      /// @}
   };
 
+  namespace detail {
+    /** writes to the body of a response, close() ends a body without a length */
+    class response_ostream : public fc::ostream {
+      public:
+        response_ostream( const server::response& r ):_rep(r){}
+        virtual size_t writesome( const char* buf, size_t len ) {
+          _rep.write( buf, len );
+          return len;
+        }
+        virtual void close() { _rep.write( nullptr, 0 ); }
+        virtual void flush() {}
+      private:
+        server::response _rep;
+    };
+  }
+
+
+  namespace detail {
+    /** the connections served by one thread */
+    struct http_worker {
+      http_worker( uint32_t i, fc::thread& t )
+      :index(i),thread(&t),connections(0),active_connections(0),requests(0),reused_requests(0),idle_timeouts(0),
+       total_latency_us(0),max_latency_us(0){}
+
+      uint32_t                                                 index;
+      fc::thread*                                              thread;
+      /** only used from thread */
+      std::unordered_map<http::connection*, http::connection_ptr> open;
+      /** set once open is empty after the server started closing */
+      fc::promise<void>::ptr                                   drained;
+
+      /// written by thread only, read by get_worker_stats() from any thread
+      /// @{
+      boost::atomic<uint64_t>                                  connections;
+      boost::atomic<uint64_t>                                  active_connections;
+      boost::atomic<uint64_t>                                  requests;
+      boost::atomic<uint64_t>                                  reused_requests;
+      boost::atomic<uint64_t>                                  idle_timeouts;
+      boost::atomic<uint64_t>                                  total_latency_us;
+      boost::atomic<uint64_t>                                  max_latency_us;
+      /// @}
+
+      void add( boost::atomic<uint64_t>& c, int64_t n = 1 ) {
+        c.store( c.load( boost::memory_order_relaxed ) + n, boost::memory_order_relaxed );
+      }
+    };
+  }
 
   class server::impl 
   {
     public:
-      impl(){}
-      impl(uint16_t p ) {
-        tcp_serv.listen(p);
-        accept_complete = fc::async([this](){ this->accept_loop(); });
-      }
+      /** kept when listen() starts over */
+      struct settings {
+        settings()
+        :idle_timeout( fc::seconds(30) ),max_requests(1000),max_buffered_body(default_max_buffered_body),access_log(nullptr),
+         num_workers(0),worker_mode(tcp_server_pool::round_robin),compress_min(uint64_t(-1)),compress_level(6){}
+        std::function<void(const http::request&, const server::response& s )> on_req;
+        microseconds                       idle_timeout;
+        uint32_t                           max_requests;
+        uint64_t                           max_buffered_body;
+        fc::logger                         access_log;
+        uint32_t                           num_workers;
+        tcp_server_pool::accept_mode       worker_mode;
+        uint64_t                           compress_min;
+        int                                compress_level;
+      };
+
+      impl( const settings& s = settings() )
+      :cfg(s),closing(false){}
       fc::future<void> accept_complete;
       ~impl() {
+        closing.store( true );
         try {
-          tcp_serv.close();
-          accept_complete.wait();
+          if( pool ) pool->close();
+          else       tcp_serv.close();
+          if( accept_complete.valid() ) accept_complete.wait();
         }catch(...){}
+        for( uint32_t i = 0; i < workers.size(); ++i ) {
+          detail::http_worker* w = workers[i].get();
+          try {
+            if( w->thread->is_current() ) drain( *w );
+            else w->thread->async( [=](){ drain( *w ); }, "http::server::drain" ).wait();
+          } catch ( ... ) {}
+        }
+        pool.reset();
+      }
+
+      /** closes the connections of w and waits for them to finish */
+      void drain( detail::http_worker& w ) {
+        if( w.open.empty() ) return;
+        w.drained.reset( new fc::promise<void>( "http::server::drain" ) );
+        // keep-alive connections may be idle for a long time, wake them up so they exit
+        auto cons = w.open;
+        for( auto itr = cons.begin(); itr != cons.end(); ++itr ) {
+          try { itr->second->get_socket().close(); } catch ( ... ) {}
+        }
+        w.drained->wait();
+      }
+
+      void listen( uint16_t p ) {
+        if( cfg.num_workers == 0 ) {
+          workers.push_back( std::unique_ptr<detail::http_worker>( new detail::http_worker( 0, fc::thread::current() ) ) );
+          tcp_serv.listen(p);
+          accept_complete = fc::async([this](){ this->accept_loop(); });
+          return;
+        }
+        pool.reset( new tcp_server_pool( cfg.num_workers, cfg.worker_mode ) );
+        for( uint32_t i = 0; i < cfg.num_workers; ++i )
+          workers.push_back( std::unique_ptr<detail::http_worker>( new detail::http_worker( i, pool->worker(i) ) ) );
+        pool->on_connection( [this]( const tcp_socket_ptr& s ) {
+          for( uint32_t i = 0; i < workers.size(); ++i ) {
+            if( workers[i]->thread->is_current() ) {
+              handle_connection( *workers[i], std::make_shared<http::connection>( s ) );
+              return;
+            }
+          }
+        } );
+        pool->listen( p );
       }
       void accept_loop() {
             http::connection_ptr con = std::make_shared<http::connection>();
             while( tcp_serv.accept( con->get_socket() ) ) {
               ilog( "Accept Connection" );
-              fc::async( [=](){ handle_connection( con, on_req ); } );
+              // registered before the fiber starts so that drain() waits for it
+              workers[0]->open[con.get()] = con;
+              fc::async( [=](){ handle_connection( *workers[0], con ); } );
               con = std::make_shared<http::connection>();
             }
       }
 
-      void handle_connection( const http::connection_ptr& c,  
-                              std::function<void(const http::request&, const server::response& s )> do_on_req ) {
+      /** answers a request without calling on_request, the connection is closed afterwards */
+      void reject( const http::connection_ptr& c, reply::status_code s, const std::shared_ptr<std::vector<char> >& head_buf ) {
+         http::server::response r( fc::shared_ptr<response::impl>( new response::impl( c, false, true, head_buf ) ) );
+         r.set_status( s );
+         r.set_length( 0 );
+         r.write( nullptr, 0 );
+      }
+
+      /** 
+       *  Serves the requests of a connection one after another, so responses to
+       *  pipelined requests go out in order, until the client or the server's limits
+       *  end it.  Runs on the thread of w.
+       */
+      void handle_connection( detail::http_worker& w, const http::connection_ptr& c ) {
+         w.open[c.get()] = c;
+         w.add( w.connections );
+         w.add( w.active_connections );
+         auto head_buf = std::make_shared<std::vector<char> >();
+         head_buf->reserve( 512 );
          try {
-             http::server::response rep( fc::shared_ptr<response::impl>( new response::impl(c, [=](){ this->handle_connection(c,do_on_req); } ) ) );
-             auto req = c->read_request();
-             if( do_on_req ) do_on_req( req, rep );
-             c->get_socket().close();
+             for( uint32_t served = 0; !closing.load(); ++served ) {
+               time_point deadline = cfg.idle_timeout == microseconds::maximum() ? 
+                                       time_point::maximum() : time_point::now() + cfg.idle_timeout;
+               http::request req;
+               try {
+                 req = c->read_request_head( deadline );
+               } catch ( const fc::timeout_exception& ) {
+                 w.add( w.idle_timeouts );
+                 break;
+               } catch ( const fc::eof_exception& ) {
+                 break; // the client closed the connection between requests
+               } catch ( const fc::parse_error_exception& e ) {
+                 // the rest of the stream can not be trusted to start with the next request
+                 if( !closing.load() ) wlog( "bad request ${e}", ("e", e.to_detail_string()) );
+                 reject( c, reply::BadRequest, head_buf );
+                 break;
+               }
+               time_point start = time_point::now();
+               w.add( w.requests );
+               if( served ) w.add( w.reused_requests );
+
+               std::shared_ptr<body_istream> body = c->body_stream();
+               if( cfg.max_buffered_body == uint64_t(-1) || 
+                   (body->framing() == body_istream::content_length && body->length() <= cfg.max_buffered_body) ) {
+                 try {
+                   body->read_all( req.body );
+                 } catch ( const fc::out_of_range_exception& ) {
+                   reject( c, reply::PayloadTooLarge, head_buf );
+                   break;
+                 }
+               } else {
+                 req.body_stream = body;
+               }
+
+               bool keep = req.keep_alive && !closing.load() && (cfg.max_requests == 0 || served + 1 < cfg.max_requests);
+               fc::shared_ptr<response::impl> ri( new response::impl( c, keep, req.version != "HTTP/1.0", head_buf ) );
+               fc::promise<bool>::ptr done = ri->done;
+               ri->head_request = req.method == "HEAD";
+               if( cfg.compress_min != uint64_t(-1) && !ri->head_request ) {
+                 ri->compress_min   = cfg.compress_min;
+                 ri->compress_level = cfg.compress_level;
+                 ri->coding         = content_coding::negotiate( req.get_header( header_id::accept_encoding ) );
+               }
+               if( cfg.access_log != nullptr ) {
+                 ri->access_log = cfg.access_log;
+                 ri->method     = req.method;
+                 ri->path       = req.path;
+                 ri->start      = start;
+               }
+               if( cfg.on_req ) cfg.on_req( req, http::server::response(ri) );
+               if( ri->retain_count() == 1 && (!ri->has_length || ri->body_length == 0) ) {
+                 // handlers may leave a body without a length unfinished, or never call
+                 // write() if there is none
+                 ri->finish();
+               }
+               // the handler may still be writing the body from another fiber, a response
+               // it drops before finishing fails done
+               ri.reset();
+               bool keep_open = done->wait();
+
+               uint64_t us = uint64_t( (time_point::now() - start).count() );
+               w.add( w.total_latency_us, us );
+               if( us > w.max_latency_us.load( boost::memory_order_relaxed ) ) 
+                 w.max_latency_us.store( us, boost::memory_order_relaxed );
+               if( !keep_open ) break;
+             }
           } catch ( fc::exception& e ) {
-             wlog( "unable to read request ${1}", ("1", e.to_detail_string() ) );//fc::except_str().c_str());
+             if( !closing.load() ) wlog( "unable to read request ${1}", ("1", e.to_detail_string() ) );//fc::except_str().c_str());
+          } catch ( const std::exception& e ) {
+             // thrown by on_request, the connection is still cleaned up so drain() does not wait for it
+             elog( "unhandled exception serving a request: ${what}", ("what", e.what()) );
+          } catch ( ... ) {
+             elog( "unhandled exception serving a request" );
           }
-          wlog( "done handle connection" );
+          try { c->get_socket().close(); } catch ( ... ) {}
+          w.add( w.active_connections, -1 );
+          w.open.erase( c.get() );
+          if( w.open.empty() && w.drained ) w.drained->set_value();
       }
-      std::function<void(const http::request&, const server::response& s )> on_req;
+
+      settings                                                              cfg;
       fc::tcp_server                                                        tcp_serv;
+      /** when there are worker threads */
+      std::unique_ptr<tcp_server_pool>                                      pool;
+      std::vector<std::unique_ptr<detail::http_worker> >                    workers;
+      boost::atomic<bool>                                                   closing;
   };
 
 
 
-  server::server(){}
-  server::server( uint16_t port ) :my( new impl(port) ){}
+  server::server():my( new impl() ){}
+  server::server( uint16_t port ) :my( new impl() ) { my->listen(port); }
   server::server( server&& s ):my(fc::move(s.my)){}
 
   server& server::operator=(server&& s)      { fc_swap(my,s.my); return *this; }
@@ -93,7 +524,58 @@ namespace fc { namespace http {
   server::~server(){}
 
   void server::listen( uint16_t p ) {
-    my.reset( new impl(p) );
+    impl::settings cfg = my->cfg;
+    my.reset( new impl( cfg ) );
+    my->listen(p);
+  }
+
+  void server::set_idle_timeout( const microseconds& t ) {
+    my->cfg.idle_timeout = t;
+  }
+  void server::set_max_requests_per_connection( uint32_t n ) {
+    my->cfg.max_requests = n;
+  }
+  void server::set_max_buffered_body( uint64_t n ) {
+    my->cfg.max_buffered_body = n;
+  }
+  void server::set_access_log( const fc::logger& log ) {
+    my->cfg.access_log = log;
+  }
+  void server::set_compression( uint64_t min_length, int level ) {
+    my->cfg.compress_min   = min_length;
+    my->cfg.compress_level = level;
+  }
+  void server::set_worker_threads( uint32_t n, tcp_server_pool::accept_mode m ) {
+    my->cfg.num_workers = n;
+    my->cfg.worker_mode = m;
+  }
+
+  std::vector<server::worker_stats> server::get_worker_stats()const {
+    std::vector<worker_stats> r( my->workers.size() );
+    for( uint32_t i = 0; i < r.size(); ++i ) {
+      const detail::http_worker& w = *my->workers[i];
+      r[i].index                          = i;
+      r[i].connections.connections        = w.connections.load( boost::memory_order_relaxed );
+      r[i].connections.active_connections = w.active_connections.load( boost::memory_order_relaxed );
+      r[i].connections.requests           = w.requests.load( boost::memory_order_relaxed );
+      r[i].connections.reused_requests    = w.reused_requests.load( boost::memory_order_relaxed );
+      r[i].connections.idle_timeouts      = w.idle_timeouts.load( boost::memory_order_relaxed );
+      r[i].total_latency_us               = w.total_latency_us.load( boost::memory_order_relaxed );
+      r[i].max_latency_us                 = w.max_latency_us.load( boost::memory_order_relaxed );
+    }
+    return r;
+  }
+  server::connection_stats server::get_connection_stats()const {
+    connection_stats s;
+    std::vector<worker_stats> ws = get_worker_stats();
+    for( auto itr = ws.begin(); itr != ws.end(); ++itr ) {
+      s.connections        += itr->connections.connections;
+      s.active_connections += itr->connections.active_connections;
+      s.requests           += itr->connections.requests;
+      s.reused_requests    += itr->connections.reused_requests;
+      s.idle_timeouts      += itr->connections.idle_timeouts;
+    }
+    return s;
   }
 
 
@@ -107,7 +589,10 @@ namespace fc { namespace http {
   server::response& server::response::operator=(server::response&& s)      { fc_swap(my,s.my); return *this; }
 
   void server::response::add_header( const fc::string& key, const fc::string& val )const {
-     wlog( "Attempt to add header after sending headers" );
+     if( my->headers_sent ) {
+       wlog( "Attempt to add header after sending headers" );
+       return;
+     }
      my->rep.headers.push_back( fc::http::header( key, val ) );
   }
   void server::response::set_status( const http::reply::status_code& s )const {
@@ -117,33 +602,81 @@ namespace fc { namespace http {
      my->rep.status = s;
   }
   void server::response::set_length( uint64_t s )const {
-    if( my->body_bytes_sent != 0 ) {
+    if( my->headers_sent ) {
       wlog( "Attempt to set length after sending headers" );
+      return;
     }
     my->body_length = s; 
+    my->has_length  = true;
   }
   void server::response::write( const char* data, uint64_t len )const {
-    if( my->body_bytes_sent + len > my->body_length ) {
+    if( my->done->ready() ) {
+      wlog( "Attempt to write after the end of the body" );
+      return;
+    }
+    if( my->has_length && my->body_bytes_sent + len > my->body_length ) {
       wlog( "Attempt to send to many bytes.." );
-      len = my->body_bytes_sent + len - my->body_length;
+      len = my->body_length - my->body_bytes_sent;
     }
-    if( my->body_bytes_sent == 0 ) {
-      my->send_header();
+    try {
+      if( !my->has_length && len == 0 ) {
+        my->finish();
+        return;
+      }
+      if( !my->headers_sent && !my->z && len && my->compress_min != uint64_t(-1) ) 
+        my->start_compression();
+      if( my->z ) {
+        bool last = my->has_length && my->body_bytes_sent + len == my->body_length;
+        my->send_compressed( data, static_cast<size_t>(len), last );
+      } else if( !my->headers_sent ) {
+        my->send_header( data, static_cast<size_t>(len) );
+      } else if( my->head_request ) {
+        // only the head is sent
+      } else if( my->chunks ) {
+        my->chunks->write_chunk( data, static_cast<size_t>(len) );
+      } else {
+        my->con->get_socket().write( data, static_cast<size_t>(len) ); 
+      }
+    } catch ( const fc::exception& e ) {
+      if( !my->done->ready() ) my->done->set_exception( e.dynamic_copy_exception() );
+      throw;
     }
     my->body_bytes_sent += len;
-    my->con->get_socket().write( data, static_cast<size_t>(len) ); 
-    if( my->body_bytes_sent == int64_t(my->body_length) ) {
-      if( my->handle_next_req ) {
-        ilog( "handle next request..." );
-        //fc::async( std::function<void()>(my->handle_next_req) );
-        fc::async( my->handle_next_req );
+    if( my->has_length && my->body_bytes_sent == int64_t(my->body_length) ) {
+      my->complete();
+    }
+  }
+  void server::response::send_file( const fc::path& file, uint64_t offset, uint64_t length )const {
+    if( my->done->ready() || my->body_bytes_sent != 0 ) {
+      wlog( "Attempt to send a file after writing the body" );
+      return;
+    }
+    if( !my->has_length ) set_length( length );
+    FC_ASSERT( my->body_length == length, "the length of the response does not match the file" );
+    try {
+      if( !my->headers_sent ) my->send_header( nullptr, 0 );
+      if( !my->head_request && length ) {
+        uint64_t sent = my->con->get_socket().send_file( file, offset, length );
+        my->body_bytes_sent = int64_t(sent);
+        if( sent != length )
+          FC_THROW_EXCEPTION( eof_exception, "${file} ended after ${sent} of ${length} bytes",
+                              ("file",file)("sent",sent)("length",length) );
       }
+    } catch ( const fc::exception& e ) {
+      if( !my->done->ready() ) my->done->set_exception( e.dynamic_copy_exception() );
+      throw;
     }
+    my->body_bytes_sent = int64_t(length);
+    my->complete();
+  }
+
+  fc::ostream_ptr server::response::body_stream()const {
+    return std::make_shared<detail::response_ostream>( *this );
   }
 
   server::response::~response(){}
   void server::on_request( const std::function<void(const http::request&, const server::response& s )>& cb )
-  { my->on_req = cb; }
+  { my->cfg.on_req = cb; }
 
 
 
@@ -0,0 +1,98 @@
+#include <fc/network/socket_stats.hpp>
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+#include <fc/exception/exception.hpp>
+#include <boost/thread/mutex.hpp>
+#include <unordered_set>
+
+namespace fc {
+
+  namespace detail {
+    boost::atomic<bool> socket_stats_on(false);
+
+    struct socket_registry {
+      boost::mutex                              mutex;
+      std::unordered_set<socket_stats_source*>  sockets;
+    };
+    socket_registry& get_socket_registry() {
+      // intentionally leaked, sockets may be destroyed during static destruction
+      static socket_registry* r = new socket_registry();
+      return *r;
+    }
+
+    socket_stats_source::socket_stats_source( const char* t )
+    :type(t),registered( socket_stats_on.load( boost::memory_order_relaxed ) ) {
+      if( !registered ) return;
+      socket_registry& r = get_socket_registry();
+      boost::unique_lock<boost::mutex> lock( r.mutex );
+      r.sockets.insert( this );
+    }
+
+    socket_stats_source::~socket_stats_source() {
+      unregister_socket();
+    }
+
+    void socket_stats_source::unregister_socket() {
+      if( !registered ) return;
+      socket_registry& r = get_socket_registry();
+      boost::unique_lock<boost::mutex> lock( r.mutex );
+      r.sockets.erase( this );
+      registered = false;
+    }
+
+    void socket_stats_source::set_endpoints( const fc::string& l, const fc::string& r ) {
+      if( !registered ) return;
+      socket_registry& reg = get_socket_registry();
+      boost::unique_lock<boost::mutex> lock( reg.mutex );
+      local  = l;
+      remote = r;
+    }
+
+    socket_stats socket_counters::snapshot()const {
+      socket_stats s;
+      s.bytes_read    = bytes_read.load( boost::memory_order_relaxed );
+      s.bytes_written = bytes_written.load( boost::memory_order_relaxed );
+      s.reads         = reads.load( boost::memory_order_relaxed );
+      s.writes        = writes.load( boost::memory_order_relaxed );
+      s.async_reads   = async_reads.load( boost::memory_order_relaxed );
+      s.async_writes  = async_writes.load( boost::memory_order_relaxed );
+      s.read_wait     = microseconds( read_wait_us.load( boost::memory_order_relaxed ) );
+      s.write_wait    = microseconds( write_wait_us.load( boost::memory_order_relaxed ) );
+      return s;
+    }
+  }
+
+  void to_variant( const socket_stats& s, variant& v ) {
+    v = mutable_variant_object( "bytes_read",    s.bytes_read )
+                              ( "bytes_written", s.bytes_written )
+                              ( "reads",         s.reads )
+                              ( "writes",        s.writes )
+                              ( "async_reads",   s.async_reads )
+                              ( "async_writes",  s.async_writes )
+                              ( "read_wait_us",  s.read_wait.count() )
+                              ( "write_wait_us", s.write_wait.count() );
+  }
+
+  void enable_socket_stats( bool enable ) {
+    detail::socket_stats_on.store( enable, boost::memory_order_relaxed );
+  }
+  bool socket_stats_enabled() {
+    return detail::socket_stats_on.load( boost::memory_order_relaxed );
+  }
+
+  variant get_live_sockets() {
+    detail::socket_registry& r = detail::get_socket_registry();
+    variants result;
+    boost::unique_lock<boost::mutex> lock( r.mutex );
+    result.reserve( r.sockets.size() );
+    for( auto itr = r.sockets.begin(); itr != r.sockets.end(); ++itr ) {
+      mutable_variant_object o( "type", fc::string((*itr)->type) );
+      if( (*itr)->local.size() )  o( "local",  (*itr)->local );
+      if( (*itr)->remote.size() ) o( "remote", (*itr)->remote );
+      o( "stats", (*itr)->stats.snapshot() );
+      result.push_back( variant(o) );
+    }
+    return variant(result);
+  }
+
+} // namespace fc
@@ -0,0 +1,162 @@
+#include <fc/network/tcp_server_pool.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+#include <boost/atomic.hpp>
+
+namespace fc {
+
+  namespace detail {
+    struct pool_worker {
+      pool_worker( uint32_t i )
+      :index(i),thread( ("tcp_worker" + fc::to_string(uint64_t(i))).c_str() ),accepted(0),active(0){}
+
+      uint32_t                 index;
+      fc::thread               thread;
+      fc::tcp_server           server;      ///< reuse_port mode only, used from thread
+      fc::future<void>         accept_complete;
+      boost::atomic<uint64_t>  accepted;
+      boost::atomic<uint64_t>  active;
+    };
+  }
+
+  class tcp_server_pool::impl {
+    public:
+      impl( uint32_t n, accept_mode m )
+      :mode(m),next(0),closed(false) {
+        FC_ASSERT( n > 0, "a tcp_server_pool needs at least one worker" );
+        workers.reserve(n);
+        for( uint32_t i = 0; i < n; ++i )
+          workers.push_back( std::unique_ptr<detail::pool_worker>( new detail::pool_worker(i) ) );
+      }
+      ~impl() {
+        try { close(); } catch ( ... ) {}
+        for( uint32_t i = 0; i < workers.size(); ++i )
+          workers[i]->thread.quit();
+      }
+
+      void listen( uint16_t port, uint32_t backlog ) {
+        FC_ASSERT( !closed, "the pool has been closed" );
+        if( mode == reuse_port ) {
+          for( uint32_t i = 0; i < workers.size(); ++i ) {
+            detail::pool_worker* w = workers[i].get();
+            w->thread.async( [=](){
+              w->server.set_reuse_port();
+              w->server.listen( port, backlog );
+            }, "tcp_server_pool::listen" ).wait();
+            w->accept_complete = w->thread.async( [=](){ accept_loop( w->server, w ); },
+                                                   "tcp_server_pool::accept" );
+          }
+        } else {
+          server.listen( port, backlog );
+          accept_complete = fc::async( [=](){ accept_loop( server, nullptr ); },
+                                       "tcp_server_pool::accept" );
+        }
+      }
+
+      void close() {
+        if( closed ) return;
+        closed = true;
+        if( mode == reuse_port ) {
+          for( uint32_t i = 0; i < workers.size(); ++i ) {
+            detail::pool_worker* w = workers[i].get();
+            if( !w->accept_complete.valid() ) continue;
+            w->thread.async( [=](){ w->server.close(); }, "tcp_server_pool::close" ).wait();
+            try { w->accept_complete.wait(); } catch ( ... ) {}
+          }
+        } else if( accept_complete.valid() ) {
+          server.close();
+          try { accept_complete.wait(); } catch ( ... ) {}
+        }
+      }
+
+      /**
+       *  @param owner the worker the listener belongs to, nullptr if connections
+       *               are handed off to the workers
+       */
+      void accept_loop( fc::tcp_server& srv, detail::pool_worker* owner ) {
+        try {
+          tcp_socket_ptr s = std::make_shared<tcp_socket>();
+          while( srv.accept( *s ) ) {
+            dispatch( owner ? *owner : pick_worker(), s );
+            s = std::make_shared<tcp_socket>();
+          }
+        } catch ( fc::exception& e ) {
+          if( !closed ) wlog( "accept failed: ${e}", ("e", e.to_detail_string()) );
+        }
+      }
+
+      detail::pool_worker& pick_worker() {
+        uint32_t start = next++ % workers.size();
+        if( mode == round_robin ) return *workers[start];
+
+        detail::pool_worker* best = workers[start].get();
+        for( uint32_t i = 1; i < workers.size(); ++i ) {
+          detail::pool_worker* w = workers[(start + i) % workers.size()].get();
+          if( w->active.load( boost::memory_order_relaxed ) < best->active.load( boost::memory_order_relaxed ) )
+            best = w;
+        }
+        return *best;
+      }
+
+      void dispatch( detail::pool_worker& w, const tcp_socket_ptr& s ) {
+        w.accepted.fetch_add( 1, boost::memory_order_relaxed );
+        w.active.fetch_add( 1, boost::memory_order_relaxed );
+        detail::pool_worker* wp = &w;
+        connection_handler h = on_con;
+        auto run = [=]() {
+          try {
+            if( h ) h( s );
+          } catch ( fc::exception& e ) {
+            wlog( "connection handler failed: ${e}", ("e", e.to_detail_string()) );
+          }
+          try { s->close(); } catch ( ... ) {}
+          wp->active.fetch_sub( 1, boost::memory_order_relaxed );
+        };
+        if( &w.thread == &fc::thread::current() ) fc::async( run, "tcp_server_pool::connection" );
+        else w.thread.async( run, "tcp_server_pool::connection" );
+      }
+
+      accept_mode                                        mode;
+      connection_handler                                 on_con;
+      std::vector<std::unique_ptr<detail::pool_worker> > workers;
+      fc::tcp_server                                     server;  ///< shared listener when not in reuse_port mode
+      fc::future<void>                                   accept_complete;
+      uint32_t                                           next;
+      bool                                               closed;
+  };
+
+  tcp_server_pool::tcp_server_pool( uint32_t num_workers, accept_mode m )
+  :my( new impl( num_workers, m ) ){}
+
+  tcp_server_pool::~tcp_server_pool(){}
+
+  void tcp_server_pool::on_connection( const connection_handler& h ) {
+    my->on_con = h;
+  }
+  void tcp_server_pool::listen( uint16_t port, uint32_t backlog ) {
+    my->listen( port, backlog );
+  }
+  void tcp_server_pool::close() {
+    my->close();
+  }
+
+  uint32_t tcp_server_pool::num_workers()const {
+    return uint32_t(my->workers.size());
+  }
+  fc::thread& tcp_server_pool::worker( uint32_t i ) {
+    FC_ASSERT( i < my->workers.size() );
+    return my->workers[i]->thread;
+  }
+
+  std::vector<tcp_server_pool::worker_stats> tcp_server_pool::get_worker_stats()const {
+    std::vector<worker_stats> stats( my->workers.size() );
+    for( uint32_t i = 0; i < stats.size(); ++i ) {
+      stats[i].index    = i;
+      stats[i].accepted = my->workers[i]->accepted.load( boost::memory_order_relaxed );
+      stats[i].active   = my->workers[i]->active.load( boost::memory_order_relaxed );
+    }
+    return stats;
+  }
+
+} // namespace fc
@@ -1,31 +1,365 @@
 #include <fc/network/tcp_socket.hpp>
 #include <fc/network/ip.hpp>
+#include <fc/network/socket_stats.hpp>
 #include <fc/fwd_impl.hpp>
 #include <fc/asio.hpp>
 #include <fc/log/logger.hpp>
 #include <fc/io/stdio.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/fstream.hpp>
+
+#if !defined(_WIN32)
+  #include <sys/socket.h>
+  #include <netinet/in.h>
+  #include <netinet/tcp.h>
+  #include <errno.h>
+  #include <string.h>
+#endif
+
+#if defined(__linux__)
+  #include <sys/uio.h>
+  #include <sys/sendfile.h>
+  #include <poll.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #define FC_TCP_SOCKET_REACTOR 1
+#endif
 
 namespace fc {
 
-  class tcp_socket::impl {
+  class tcp_socket::impl : public detail::socket_stats_source {
     public:
-      impl():_sock( fc::asio::default_io_service() ){  }
+      impl()
+      :detail::socket_stats_source("tcp"),
+       _sock( fc::asio::next_io_service() ),_reactor(nullptr),_uring(false),
+       _read_slot("fc::tcp_socket::read"),_write_slot("fc::tcp_socket::write"){  }
       ~impl(){
-        if( _sock.is_open() ) _sock.close();
+        unregister_socket();
+        close();
+      }
+
+      /** hands the endpoints to get_live_sockets(), which must not query the socket itself */
+      void remember_endpoints() {
+        if( !is_registered() ) return;
+        boost::system::error_code ec;
+        auto lep = _sock.local_endpoint( ec );
+        fc::string l = ec ? fc::string() : fc::string( fc::ip::endpoint( lep.address().to_v4().to_ulong(), lep.port() ) );
+        auto rep = _sock.remote_endpoint( ec );
+        fc::string r = ec ? fc::string() : fc::string( fc::ip::endpoint( rep.address().to_v4().to_ulong(), rep.port() ) );
+        set_endpoints( l, r );
+      }
+      size_t count_read( size_t n ) {
+        socket_stats_source::count_read( n );
+        return n;
+      }
+      size_t count_write( size_t n ) {
+        socket_stats_source::count_write( n );
+        return n;
+      }
+
+      /** counts the operations started on the slot until it goes out of scope as waits */
+      class slot_waits {
+        public:
+          slot_waits( impl& i, bool write )
+          :_impl(i),_write(write),_started( i.is_registered() ? slot().started() : 0 ){}
+          ~slot_waits() { if( _impl.is_registered() ) _impl.count_wait( _write, slot().started() - _started ); }
+        private:
+          const fc::asio::completion_slot& slot()const { return _write ? _impl._write_slot : _impl._read_slot; }
+          impl&    _impl;
+          bool     _write;
+          uint64_t _started;
+      };
+
+      /** @param shut false leaves the connection to other copies of the descriptor */
+      void close( bool shut = true ) {
+        if( !_sock.is_open() ) return;
+        if( _reactor ) {
+          fc::thread::cancel_io( _reactor_ref, _sock.native_handle() );
+#ifdef FC_TCP_SOCKET_REACTOR
+          // io_uring requests keep the file open, wake them up with eof
+          if( _uring && shut ) ::shutdown( _sock.native_handle(), SHUT_RDWR );
+#endif
+        }
+        _sock.close();
+      }
+
+#ifdef FC_TCP_SOCKET_REACTOR
+      /**
+       *  Performs the I/O directly on the calling thread, waiting for readiness
+       *  with its io reactor instead of going through the asio thread.
+       */
+      size_t reactor_readsome( char* buf, size_t len, const time_point& deadline = time_point::maximum() ) {
+        int fd = use_reactor();
+        // io_uring reads cannot be abandoned at a deadline, wait for readiness instead
+        if( _reactor->get_io_engine() == fc::thread::uring_engine && deadline == time_point::maximum() ) {
+          count_wait( false );
+          size_t r = _reactor->uring_read( fd, buf, len );
+          if( r == 0 ) FC_THROW_EXCEPTION( eof_exception, "" );
+          return r;
+        }
+        while( true ) {
+          ssize_t r = ::recv( fd, buf, len, 0 );
+          if( r > 0 ) return size_t(r);
+          if( r == 0 ) FC_THROW_EXCEPTION( eof_exception, "" );
+          if( errno == EAGAIN || errno == EWOULDBLOCK ) reactor_wait( fd, false, deadline );
+          else if( errno != EINTR ) 
+            FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+        }
+      }
+      size_t reactor_writesome( const char* buf, size_t len ) {
+        int fd = use_reactor();
+        if( _reactor->get_io_engine() == fc::thread::uring_engine ) {
+          count_wait( true );
+          return _reactor->uring_send( fd, buf, len );
+        }
+        while( true ) {
+          ssize_t r = ::send( fd, buf, len, MSG_NOSIGNAL );
+          if( r >= 0 ) return size_t(r);
+          if( errno == EAGAIN || errno == EWOULDBLOCK ) reactor_wait( fd, true );
+          else if( errno != EINTR ) 
+            FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+        }
+      }
+      /** iovecs per readv/sendmsg, well below IOV_MAX */
+      enum { max_iovecs = 64 };
+
+      /** 
+       *  Puts the non empty buffers from bufs on into iov, at most max_iovecs of them.
+       *  @return how many of the buffers were taken, n the iovecs and len their size
+       */
+      template<typename Buffer>
+      static size_t to_iovecs( const Buffer* bufs, size_t count, iovec* iov, int& n, size_t& len ) {
+        size_t i = 0;
+        n = 0; len = 0;
+        for( ; i < count && n < max_iovecs; ++i ) {
+          if( !bufs[i].size ) continue;
+          iov[n].iov_base = const_cast<char*>(bufs[i].data);
+          iov[n].iov_len  = bufs[i].size;
+          len += bufs[i].size;
+          ++n;
+        }
+        return i;
+      }
+
+      /** reads batch after batch while they are filled, returns 0 if the buffers are empty */
+      size_t reactor_readvsome( const mutable_buffer* bufs, size_t count ) {
+        int fd = use_reactor();
+        iovec  iov[max_iovecs];
+        size_t total = 0;
+        while( true ) {
+          int    n;
+          size_t len;
+          size_t used = to_iovecs( bufs, count, iov, n, len );
+          if( !n ) return total;
+          ssize_t r = ::readv( fd, iov, n );
+          if( r > 0 ) {
+            total += r;
+            if( size_t(r) < len ) return total;
+            bufs += used; count -= used;
+            continue;
+          }
+          if( total ) return total;
+          if( r == 0 ) FC_THROW_EXCEPTION( eof_exception, "" );
+          if( errno == EAGAIN || errno == EWOULDBLOCK ) reactor_wait( fd, false );
+          else if( errno != EINTR ) 
+            FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+        }
+      }
+      /** sends batch after batch while they are sent whole, returns 0 if the buffers are empty */
+      size_t reactor_writevsome( const const_buffer* bufs, size_t count ) {
+        int fd = use_reactor();
+        iovec  iov[max_iovecs];
+        size_t total = 0;
+        while( true ) {
+          int    n;
+          size_t len;
+          size_t used = to_iovecs( bufs, count, iov, n, len );
+          if( !n ) return total;
+          msghdr msg;
+          memset( &msg, 0, sizeof(msg) );
+          msg.msg_iov    = iov;
+          msg.msg_iovlen = n;
+          ssize_t r = ::sendmsg( fd, &msg, MSG_NOSIGNAL );
+          if( r >= 0 ) {
+            total += r;
+            if( size_t(r) < len ) return total;
+            bufs += used; count -= used;
+            continue;
+          }
+          if( total ) return total;
+          if( errno == EAGAIN || errno == EWOULDBLOCK ) reactor_wait( fd, true );
+          else if( errno != EINTR ) 
+            FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+        }
+      }
+      void reactor_wait( int fd, bool write, const time_point& deadline = time_point::maximum() ) {
+        count_wait( write );
+        _reactor->wait_io( fd, write, deadline );
+      }
+      int use_reactor() {
+        if( !_reactor ) {
+          _sock.non_blocking(true);
+          _reactor = &fc::thread::current();
+          _reactor_ref = _reactor->get_io_reactor();
+          _uring = _reactor->get_io_engine() == fc::thread::uring_engine;
+        }
+        FC_ASSERT( _reactor == &fc::thread::current(), "socket is used from another thread's reactor" );
+        return _sock.native_handle();
       }
+#endif
+
+      /** cooperatively waits until the socket can be written without blocking */
+      void wait_writable() {
+#ifdef FC_TCP_SOCKET_REACTOR
+        if( fc::thread::current().has_io_reactor() ) {
+          int fd = use_reactor();
+          _reactor->wait_io( fd, true );
+          return;
+        }
+#endif
+        fc::asio::wait_writable( _sock, _write_slot );
+      }
+      void wait_readable() {
+#ifdef FC_TCP_SOCKET_REACTOR
+        if( fc::thread::current().has_io_reactor() ) {
+          int fd = use_reactor();
+          _reactor->wait_io( fd, false );
+          return;
+        }
+#endif
+        fc::asio::wait_readable( _sock, _read_slot );
+      }
+
+#ifdef FC_TCP_SOCKET_REACTOR
+      /**
+       *  splice(2) loop shared by both directions.  Either side may cause EAGAIN, 
+       *  so poll tells which one to wait on.  poll may also report both ready while
+       *  splice still fails, the socket is then waited on, backing off while that 
+       *  keeps happening, rather than retrying right away.
+       */
+      uint64_t splice( int in, int out, uint64_t length, bool into_socket, 
+                       const std::function<void()>& wait_pipe ) {
+        uint64_t total    = 0;
+        int      spurious = 0;
+        while( total < length ) {
+          size_t chunk = size_t( (std::min)( length - total, uint64_t(1) << 20 ) );
+          ssize_t r = ::splice( in, nullptr, out, nullptr, chunk, 
+                                SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE );
+          if( r > 0 ) { total += uint64_t(r); spurious = 0; continue; }
+          if( r == 0 ) break;
+          if( errno == EINTR ) continue;
+          if( errno != EAGAIN ) 
+            FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+
+          pollfd pf[2];
+          pf[0].fd = in;  pf[0].events = POLLIN;  pf[0].revents = 0;
+          pf[1].fd = out; pf[1].events = POLLOUT; pf[1].revents = 0;
+          ::poll( pf, 2, 0 );
+          if( !(pf[0].revents & (POLLIN | POLLHUP | POLLERR)) ) {
+            if( into_socket ) wait_pipe(); 
+            else wait_readable();
+          } else if( !(pf[1].revents & (POLLOUT | POLLERR)) ) {
+            if( into_socket ) wait_writable(); 
+            else wait_pipe();
+          } else {
+            if( ++spurious > 1 ) fc::usleep( fc::microseconds( (std::min)( spurious * 50, 1000 ) ) );
+            if( into_socket ) wait_writable();
+            else wait_readable();
+          }
+        }
+        return total;
+      }
+#endif
+
+      void set_option( int level, int name, int value ) {
+#if !defined(_WIN32)
+        if( ::setsockopt( _sock.native_handle(), level, name, &value, sizeof(value) ) != 0 )
+          FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+#endif
+      }
+
       boost::asio::ip::tcp::socket _sock;
+      fc::thread*                  _reactor; ///< thread whose io reactor this socket waits on
+      /** closes may run on another thread after _reactor has exited */
+      fc::thread::reactor_ptr      _reactor_ref;
+      /** set if _reactor performs the reads and writes through its io_uring */
+      bool                         _uring;
+      fc::asio::completion_slot    _read_slot;
+      fc::asio::completion_slot    _write_slot;
   };
+  namespace detail {
+    template<typename Buffer, typename AsioBuffer>
+    void to_asio_buffers( const Buffer* bufs, size_t count, std::vector<AsioBuffer>& seq ) {
+      seq.reserve( count );
+      for( size_t i = 0; i < count; ++i ) 
+        if( bufs[i].size ) seq.push_back( AsioBuffer( bufs[i].data, bufs[i].size ) );
+    }
+  }
+
   bool tcp_socket::is_open()const {
     return my->_sock.is_open();
   }
 
+  void tcp_socket::set_no_delay( bool enable ) {
+    my->_sock.set_option( boost::asio::ip::tcp::no_delay(enable) );
+  }
+  void tcp_socket::set_send_buffer_size( size_t s ) {
+    my->_sock.set_option( boost::asio::socket_base::send_buffer_size(int(s)) );
+  }
+  void tcp_socket::set_receive_buffer_size( size_t s ) {
+    my->_sock.set_option( boost::asio::socket_base::receive_buffer_size(int(s)) );
+  }
+  /** the kernel takes whole seconds and rejects 0, so round up */
+  static int keep_alive_seconds( const microseconds& t ) {
+    return int( (std::max)( (t.count() + 999999) / 1000000, int64_t(1) ) );
+  }
+
+  void tcp_socket::set_keep_alive( bool enable, const microseconds& idle, 
+                                   const microseconds& interval, uint32_t probes ) {
+    my->_sock.set_option( boost::asio::socket_base::keep_alive(enable) );
+    if( !enable ) return;
+#if defined(TCP_KEEPIDLE)
+    if( idle.count() )     my->set_option( IPPROTO_TCP, TCP_KEEPIDLE,  keep_alive_seconds( idle ) );
+#elif defined(TCP_KEEPALIVE) // darwin
+    if( idle.count() )     my->set_option( IPPROTO_TCP, TCP_KEEPALIVE, keep_alive_seconds( idle ) );
+#endif
+#if defined(TCP_KEEPINTVL)
+    if( interval.count() ) my->set_option( IPPROTO_TCP, TCP_KEEPINTVL, keep_alive_seconds( interval ) );
+#endif
+#if defined(TCP_KEEPCNT)
+    if( probes )           my->set_option( IPPROTO_TCP, TCP_KEEPCNT,   int(probes) );
+#endif
+  }
+  void tcp_socket::set_quick_ack( bool enable ) {
+#if defined(TCP_QUICKACK)
+    my->set_option( IPPROTO_TCP, TCP_QUICKACK, enable ? 1 : 0 );
+#endif
+  }
+
+  int tcp_socket::native_handle() {
+    return my->_sock.native_handle();
+  }
+  void tcp_socket::assign( int fd ) {
+    my->close();
+    my->_reactor = nullptr;
+    my->_reactor_ref.reset();
+    my->_uring = false;
+    my->_sock.assign( boost::asio::ip::tcp::v4(), fd );
+    my->_sock.non_blocking(true);
+    my->remember_endpoints();
+  }
+
   tcp_socket::tcp_socket(){};
 
   tcp_socket::~tcp_socket(){};
 
   void tcp_socket::flush() {}
   void tcp_socket::close() {
-    if( is_open() ) my->_sock.close();
+    my->close();
+  }
+  void tcp_socket::detach() {
+    my->close( false );
   }
 
   bool tcp_socket::eof()const {
@@ -33,8 +367,116 @@ namespace fc {
   }
 
   size_t   tcp_socket::writesome( const char* buf, size_t len ) {
-    return fc::asio::write_some( my->_sock, boost::asio::buffer( buf, len ) );
+    detail::io_timer timer( *my, true );
+#ifdef FC_TCP_SOCKET_REACTOR
+    if( fc::thread::current().has_io_reactor() ) return my->count_write( my->reactor_writesome( buf, len ) );
+#endif
+    impl::slot_waits waits( *my, true );
+    return my->count_write( fc::asio::write_some( my->_sock, boost::asio::buffer( buf, len ), my->_write_slot ) );
+  }
+
+  size_t tcp_socket::writevsome( const const_buffer* bufs, size_t count ) {
+    detail::io_timer timer( *my, true );
+#ifdef FC_TCP_SOCKET_REACTOR
+    if( fc::thread::current().has_io_reactor() ) return my->count_write( my->reactor_writevsome( bufs, count ) );
+#endif
+    std::vector<boost::asio::const_buffer> seq;
+    detail::to_asio_buffers( bufs, count, seq );
+    impl::slot_waits waits( *my, true );
+    return my->count_write( fc::asio::write_some( my->_sock, seq, my->_write_slot ) );
+  }
+
+  ostream& tcp_socket::writev( const const_buffer* bufs, size_t count ) {
+#ifdef FC_TCP_SOCKET_REACTOR
+    if( fc::thread::current().has_io_reactor() ) return ostream::writev( bufs, count );
+#endif
+    std::vector<boost::asio::const_buffer> seq;
+    detail::to_asio_buffers( bufs, count, seq );
+    if( seq.empty() ) return *this;
+    detail::io_timer timer( *my, true );
+    size_t total = boost::asio::buffer_size( seq );
+    if( my->_sock.non_blocking() ) {
+      // try to send everything with one sendmsg before falling back to async_write
+      boost::system::error_code ec;
+      size_t sent = my->_sock.write_some( seq, ec );
+      if( ec && ec != boost::asio::error::would_block ) fc::asio::detail::throw_error( ec );
+      size_t first = 0;
+      while( first < seq.size() && sent >= boost::asio::buffer_size( seq[first] ) ) 
+        sent -= boost::asio::buffer_size( seq[first++] );
+      if( first == seq.size() ) { my->count_write( total ); return *this; }
+      seq.erase( seq.begin(), seq.begin() + first );
+      seq.front() = seq.front() + sent;
+    }
+    {
+      impl::slot_waits waits( *my, true );
+      fc::asio::write( my->_sock, seq, my->_write_slot );
+    }
+    my->count_write( total );
+    return *this;
+  }
+
+#ifdef FC_TCP_SOCKET_REACTOR
+  uint64_t tcp_socket::send_file( const fc::path& file, uint64_t offset, uint64_t length ) {
+    int fd = ::open( file.string().c_str(), O_RDONLY | O_CLOEXEC );
+    if( fd < 0 ) {
+      if( errno == ENOENT ) FC_THROW_EXCEPTION( file_not_found_exception, "${file}", ("file", file) );
+      FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+    }
+    struct fd_guard { int fd; ~fd_guard(){ ::close(fd); } } guard = { fd };
+
+    int sock = my->_sock.native_handle();
+    if( !my->_sock.non_blocking() ) my->_sock.non_blocking(true);
+    detail::io_timer timer( *my, true );
+    off_t    off  = off_t(offset);
+    uint64_t sent = 0;
+    while( sent < length ) {
+      size_t chunk = size_t( (std::min)( length - sent, uint64_t(1) << 30 ) );
+      ssize_t r = ::sendfile( sock, fd, &off, chunk );
+      if( r > 0 ) sent += my->count_write( size_t(r) );
+      else if( r == 0 ) break; // end of file
+      else if( errno == EAGAIN || errno == EWOULDBLOCK ) my->wait_writable();
+      else if( errno != EINTR )
+        FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+    }
+    return sent;
+  }
+
+  uint64_t tcp_socket::splice_from( int fd, uint64_t length, const std::function<void()>& wait_readable ) {
+    if( !my->_sock.non_blocking() ) my->_sock.non_blocking(true);
+    detail::io_timer timer( *my, true );
+    uint64_t r = my->splice( fd, my->_sock.native_handle(), length, true, wait_readable );
+    my->count_write( r );
+    return r;
+  }
+  uint64_t tcp_socket::splice_to( int fd, uint64_t length, const std::function<void()>& wait_writable ) {
+    if( !my->_sock.non_blocking() ) my->_sock.non_blocking(true);
+    detail::io_timer timer( *my, false );
+    uint64_t r = my->splice( my->_sock.native_handle(), fd, length, false, wait_writable );
+    my->count_read( r );
+    return r;
   }
+#else
+  uint64_t tcp_socket::send_file( const fc::path& file, uint64_t offset, uint64_t length ) {
+    fc::ifstream in( file, fc::ifstream::binary );
+    in.seekg( size_t(offset) );
+    std::vector<char> buf( 64*1024 );
+    uint64_t sent = 0;
+    try {
+      while( sent < length ) {
+        size_t r = in.readsome( buf.data(), size_t( (std::min)( uint64_t(buf.size()), length - sent ) ) );
+        write( buf.data(), r );
+        sent += r;
+      }
+    } catch ( const fc::eof_exception& ) {}
+    return sent;
+  }
+  uint64_t tcp_socket::splice_from( int, uint64_t, const std::function<void()>& ) {
+    FC_THROW_EXCEPTION( exception, "splice is not supported on this platform" );
+  }
+  uint64_t tcp_socket::splice_to( int, uint64_t, const std::function<void()>& ) {
+    FC_THROW_EXCEPTION( exception, "splice is not supported on this platform" );
+  }
+#endif
 
  fc::ip::endpoint tcp_socket::remote_endpoint()const
  {
@@ -43,24 +485,76 @@ namespace fc {
  }
 
   size_t tcp_socket::readsome( char* buf, size_t len ) {
-    auto r =  fc::asio::read_some( my->_sock, boost::asio::buffer( buf, len ) );
-    return r;
+    detail::io_timer timer( *my, false );
+#ifdef FC_TCP_SOCKET_REACTOR
+    if( fc::thread::current().has_io_reactor() ) return my->count_read( my->reactor_readsome( buf, len ) );
+#endif
+    impl::slot_waits waits( *my, false );
+    auto r =  fc::asio::read_some( my->_sock, boost::asio::buffer( buf, len ), my->_read_slot );
+    return my->count_read( r );
+  }
+
+  size_t tcp_socket::readvsome( const mutable_buffer* bufs, size_t count ) {
+    detail::io_timer timer( *my, false );
+#ifdef FC_TCP_SOCKET_REACTOR
+    if( fc::thread::current().has_io_reactor() ) return my->count_read( my->reactor_readvsome( bufs, count ) );
+#endif
+    std::vector<boost::asio::mutable_buffer> seq;
+    detail::to_asio_buffers( bufs, count, seq );
+    impl::slot_waits waits( *my, false );
+    return my->count_read( fc::asio::read_some( my->_sock, seq, my->_read_slot ) );
+  }
+
+  size_t tcp_socket::readsome_until( char* buf, size_t len, const time_point& deadline ) {
+    detail::io_timer timer( *my, false );
+#ifdef FC_TCP_SOCKET_REACTOR
+    if( fc::thread::current().has_io_reactor() ) return my->count_read( my->reactor_readsome( buf, len, deadline ) );
+#endif
+    impl::slot_waits waits( *my, false );
+    return my->count_read( fc::asio::read_some( my->_sock, boost::asio::buffer( buf, len ), my->_read_slot, deadline ) );
   }
 
   void tcp_socket::connect_to( const fc::ip::endpoint& e ) {
-    fc::asio::tcp::connect(my->_sock, fc::asio::tcp::endpoint( boost::asio::ip::address_v4(e.get_address()), e.port() ) ); 
+    connect_to( e, microseconds::maximum() );
+  }
+
+  void tcp_socket::connect_to( const fc::ip::endpoint& e, const microseconds& timeout ) {
+    time_point deadline = timeout == microseconds::maximum() ? time_point::maximum() : time_point::now() + timeout;
+    fc::asio::tcp::connect(my->_sock, fc::asio::tcp::endpoint( boost::asio::ip::address_v4(e.get_address()), e.port() ),
+                            my->_write_slot, deadline ); 
+    // reads and writes try the socket directly before waiting on the reactor
+    my->_sock.non_blocking(true);
+    my->remember_endpoints();
   }
 
   class tcp_server::impl {
     public:
-      impl(uint16_t port):
-      _accept( fc::asio::default_io_service(), boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port) ){
-      }
+      // each listener is given its own reactor, like the sockets, so that several
+      // reuse_port listeners do not all complete their accepts on reactor 0
+      impl()
+      :_accept( fc::asio::next_io_service() ),_reuse_address(true),_reuse_port(false){}
       ~impl(){
         _accept.close();
       }
 
+      void listen( uint16_t port, uint32_t backlog ) {
+        boost::asio::ip::tcp::endpoint ep( boost::asio::ip::tcp::v4(), port );
+        _accept.open( ep.protocol() );
+        _accept.set_option( boost::asio::socket_base::reuse_address(_reuse_address) );
+#if defined(SO_REUSEPORT)
+        if( _reuse_port ) {
+          int on = 1;
+          if( ::setsockopt( _accept.native_handle(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on) ) != 0 )
+            FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+        }
+#endif
+        _accept.bind( ep );
+        _accept.listen( backlog ? int(backlog) : int(boost::asio::socket_base::max_connections) );
+      }
+
       boost::asio::ip::tcp::acceptor _accept;
+      bool                           _reuse_address;
+      bool                           _reuse_port;
   };
   void tcp_server::close() {
     if( my && my->_accept.is_open() ) my->_accept.close();
@@ -75,11 +569,17 @@ namespace fc {
 
 
   bool tcp_server::accept( tcp_socket& s ) {
+    return accept_until( s, time_point::maximum() );
+  }
+
+  bool tcp_server::accept_until( tcp_socket& s, const time_point& deadline ) {
     try
     {
-      if( !my ) return false;
+      if( !my || !my->_accept.is_open() ) return false;
 
-      fc::asio::tcp::accept( my->_accept, s.my->_sock  ); 
+      fc::asio::tcp::accept( my->_accept, s.my->_sock, s.my->_read_slot, deadline ); 
+      s.my->_sock.non_blocking(true);
+      s.my->remember_endpoints();
       /*
       fc::promise<void>::ptr p( new promise<void>("tcp::accept") );
       my->_accept.async_accept( s.my->_sock, [=]( const boost::system::error_code& e ) {
@@ -92,9 +592,21 @@ namespace fc {
       return true;
     } FC_RETHROW_EXCEPTIONS( warn, "Unable to accept connection on socket." );
   }
-  void tcp_server::listen( uint16_t port ) {
-    if( my ) delete my;
-    my = new impl(port);
+  void tcp_server::listen( uint16_t port, uint32_t backlog ) {
+    if( !my ) my = new impl();
+    else if( my->_accept.is_open() ) my->_accept.close();
+    my->listen( port, backlog );
+  }
+  void tcp_server::set_reuse_address( bool enable ) {
+    if( !my ) my = new impl();
+    my->_reuse_address = enable;
+  }
+  void tcp_server::set_reuse_port( bool enable ) {
+#if !defined(SO_REUSEPORT)
+    if( enable ) FC_THROW_EXCEPTION( exception, "SO_REUSEPORT is not supported on this platform" );
+#endif
+    if( !my ) my = new impl();
+    my->_reuse_port = enable;
   }
 
 
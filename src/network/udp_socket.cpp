@@ -1,19 +1,90 @@
 #include <fc/network/udp_socket.hpp>
 #include <fc/network/ip.hpp>
+#include <fc/network/socket_stats.hpp>
 #include <fc/fwd_impl.hpp>
 #include <fc/asio.hpp>
+#include <fc/thread/thread.hpp>
+
+#if defined(__linux__)
+  #include <sys/socket.h>
+  #include <netinet/in.h>
+  #include <netinet/udp.h>
+  #include <arpa/inet.h>
+  #include <errno.h>
+  #include <string.h>
+  #define FC_UDP_MMSG 1
+#endif
 
 
 namespace fc {
   
-  class udp_socket::impl : public fc::retainable {
+  class udp_socket::impl : public fc::retainable, public detail::socket_stats_source {
     public:
-      impl():_sock( fc::asio::default_io_service() ){}
+      impl()
+      :detail::socket_stats_source("udp"),
+       _sock( fc::asio::next_io_service() ),
+       _read_slot("fc::udp_socket::read"),_write_slot("fc::udp_socket::write"),
+       _receiving(false),_sending(false){}
       ~impl(){
+        unregister_socket();
       //  _sock.cancel();
       }
 
+      /** hands the endpoints to get_live_sockets(), which must not query the socket itself */
+      void remember_endpoints() {
+        if( !is_registered() ) return;
+        boost::system::error_code ec;
+        auto lep = _sock.local_endpoint( ec );
+        fc::string l = ec ? fc::string() : fc::string( fc::ip::endpoint( lep.address().to_v4().to_ulong(), lep.port() ) );
+        auto rep = _sock.remote_endpoint( ec );
+        fc::string r = ec ? fc::string() : fc::string( fc::ip::endpoint( rep.address().to_v4().to_ulong(), rep.port() ) );
+        set_endpoints( l, r );
+      }
+
+      /** 
+       *  Cooperatively waits until the socket is readable or writable.  The slots, like
+       *  the io reactor, take one waiter per direction, copies of the socket share them.
+       */
+      void wait( bool write ) {
+        count_wait( write );
+        bool& busy = write ? _sending : _receiving;
+        if( busy )
+          FC_THROW_EXCEPTION( assert_exception, "another fiber is already ${op} on this udp_socket", 
+                              ("op", write ? "sending" : "receiving") );
+        busy = true;
+        try {
+          wait_ready( write );
+        } catch( ... ) {
+          busy = false;
+          throw;
+        }
+        busy = false;
+      }
+      void wait_ready( bool write ) {
+        fc::thread& t = fc::thread::current();
+        if( t.has_io_reactor() ) {
+          if( !_reactor_ref ) _reactor_ref = t.get_io_reactor();
+          t.wait_io( _sock.native_handle(), write );
+          return;
+        }
+        boost::system::error_code ec;
+        if( write ) {
+          _sock.async_send( boost::asio::null_buffers(), _write_slot.handler() );
+          _write_slot.wait( ec );
+        } else {
+          _sock.async_receive( boost::asio::null_buffers(), _read_slot.handler() );
+          _read_slot.wait( ec );
+        }
+        if( ec ) fc::asio::detail::throw_error( ec );
+      }
+
       boost::asio::ip::udp::socket _sock;
+      fc::asio::completion_slot    _read_slot;
+      fc::asio::completion_slot    _write_slot;
+      bool                         _receiving;
+      bool                         _sending;
+      /** of the thread whose io reactor the socket waited on, woken up by close() */
+      fc::thread::reactor_ptr      _reactor_ref;
   };
 
   boost::asio::ip::udp::endpoint to_asio_ep( const fc::ip::endpoint& e ) {
@@ -32,10 +103,14 @@ namespace fc {
   }
 
   size_t udp_socket::send_to( const char* b, size_t l, const ip::endpoint& to ) {
+    detail::io_timer timer( *my, true );
     try {
-      return my->_sock.send_to( boost::asio::buffer(b, l), to_asio_ep(to) );
+      size_t r = my->_sock.send_to( boost::asio::buffer(b, l), to_asio_ep(to) );
+      my->count_write( r );
+      return r;
     } catch( const boost::system::system_error& e ) {
         if( e.code() == boost::asio::error::would_block ) {
+            my->count_wait( true );
             promise<size_t>::ptr p(new promise<size_t>("udp_socket::send_to"));
             my->_sock.async_send_to( boost::asio::buffer(b,l), to_asio_ep(to), 
                 [=]( const boost::system::error_code& ec, size_t bt ) {
@@ -45,7 +120,9 @@ namespace fc {
                               FC_LOG_MESSAGE( error, "${message} ", 
                               ("message", boost::system::system_error(ec).what())) ) ) );
                 });
-            return p->wait();
+            size_t r = p->wait();
+            my->count_write( r );
+            return r;
         }
         throw;
     }
@@ -59,15 +136,19 @@ namespace fc {
   }
   void udp_socket::bind( const fc::ip::endpoint& e ) {
     my->_sock.bind( to_asio_ep(e) );
+    my->remember_endpoints();
   }
   size_t udp_socket::receive_from( char* b, size_t l, fc::ip::endpoint& _from ) {
+    detail::io_timer timer( *my, false );
     try {
       boost::asio::ip::udp::endpoint from;
       size_t r =  my->_sock.receive_from( boost::asio::buffer(b, l), from );
       _from = to_fc_ep(from);
+      my->count_read( r );
       return r;
     } catch( const boost::system::system_error& e ) {
         if( e.code() == boost::asio::error::would_block ) {
+            my->count_wait( false );
             boost::asio::ip::udp::endpoint from;
             promise<size_t>::ptr p(new promise<size_t>("udp_socket::send_to"));
             my->_sock.async_receive_from( boost::asio::buffer(b,l), from,
@@ -79,13 +160,150 @@ namespace fc {
                 });
             auto r =  p->wait();
             _from = to_fc_ep(from);
+            my->count_read( r );
             return r;
         }
         throw;
     }
   }
+#ifdef FC_UDP_MMSG
+  namespace detail {
+    const size_t max_batch = 64;
+    /** room for a UDP_GRO / UDP_SEGMENT control message */
+    const size_t udp_cmsg_space = CMSG_SPACE(sizeof(int));
+  }
+
+  size_t udp_socket::receive_many( datagram* d, size_t count ) {
+    if( count == 0 ) return 0;
+    size_t n = (std::min)( count, detail::max_batch );
+    mmsghdr     msgs[detail::max_batch];
+    iovec       iov[detail::max_batch];
+    sockaddr_in addrs[detail::max_batch];
+    char        ctrl[detail::max_batch][detail::udp_cmsg_space];
+    int fd = my->_sock.native_handle();
+    detail::io_timer timer( *my, false );
+    while( true ) {
+      memset( msgs, 0, sizeof(mmsghdr) * n );
+      for( size_t i = 0; i < n; ++i ) {
+        iov[i].iov_base = d[i].data;
+        iov[i].iov_len  = d[i].size;
+        msgs[i].msg_hdr.msg_iov        = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen     = 1;
+        msgs[i].msg_hdr.msg_name       = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen    = sizeof(addrs[i]);
+        msgs[i].msg_hdr.msg_control    = ctrl[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+      }
+      int r = ::recvmmsg( fd, msgs, unsigned(n), MSG_DONTWAIT, nullptr );
+      if( r > 0 ) {
+        size_t total = 0;
+        for( int i = 0; i < r; ++i ) {
+          d[i].received     = msgs[i].msg_len;
+          total            += msgs[i].msg_len;
+          d[i].endpoint     = fc::ip::endpoint( ntohl(addrs[i].sin_addr.s_addr), ntohs(addrs[i].sin_port) );
+          d[i].segment_size = 0;
+#ifdef UDP_GRO
+          for( cmsghdr* c = CMSG_FIRSTHDR(&msgs[i].msg_hdr); c; c = CMSG_NXTHDR(&msgs[i].msg_hdr, c) ) {
+            if( c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO ) {
+              int seg;
+              memcpy( &seg, CMSG_DATA(c), sizeof(seg) );
+              d[i].segment_size = uint16_t(seg);
+            }
+          }
+#endif
+        }
+        my->count_read( total );
+        return size_t(r);
+      }
+      if( errno == EAGAIN || errno == EWOULDBLOCK ) my->wait( false );
+      else if( errno != EINTR )
+        FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+    }
+  }
+
+  size_t udp_socket::send_many( const datagram* d, size_t count ) {
+    mmsghdr     msgs[detail::max_batch];
+    iovec       iov[detail::max_batch];
+    sockaddr_in addrs[detail::max_batch];
+    char        ctrl[detail::max_batch][detail::udp_cmsg_space];
+    int fd = my->_sock.native_handle();
+    detail::io_timer timer( *my, true );
+    size_t sent = 0;
+    while( sent < count ) {
+      size_t n = (std::min)( count - sent, detail::max_batch );
+      memset( msgs, 0, sizeof(mmsghdr) * n );
+      for( size_t i = 0; i < n; ++i ) {
+        const datagram& g = d[sent+i];
+        iov[i].iov_base = g.data;
+        iov[i].iov_len  = g.size;
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if( g.endpoint != fc::ip::endpoint() ) {
+          memset( &addrs[i], 0, sizeof(addrs[i]) );
+          addrs[i].sin_family      = AF_INET;
+          addrs[i].sin_addr.s_addr = htonl( uint32_t(g.endpoint.get_address()) );
+          addrs[i].sin_port        = htons( g.endpoint.port() );
+          msgs[i].msg_hdr.msg_name    = &addrs[i];
+          msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        }
+#ifdef UDP_SEGMENT
+        if( g.segment_size ) {
+          memset( ctrl[i], 0, sizeof(ctrl[i]) );
+          msgs[i].msg_hdr.msg_control    = ctrl[i];
+          msgs[i].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+          cmsghdr* c    = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+          c->cmsg_level = SOL_UDP;
+          c->cmsg_type  = UDP_SEGMENT;
+          c->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+          memcpy( CMSG_DATA(c), &g.segment_size, sizeof(uint16_t) );
+        }
+#endif
+      }
+      int r = ::sendmmsg( fd, msgs, unsigned(n), MSG_DONTWAIT );
+      if( r > 0 ) {
+        size_t bytes = 0;
+        for( int i = 0; i < r; ++i ) bytes += msgs[i].msg_len;
+        my->count_write( bytes );
+        sent += size_t(r);
+      }
+      else if( r == 0 || errno == EAGAIN || errno == EWOULDBLOCK ) my->wait( true );
+      else if( errno != EINTR )
+        FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+    }
+    return sent;
+  }
+
+  bool udp_socket::set_gro( bool enable ) {
+#ifdef UDP_GRO
+    int on = enable ? 1 : 0;
+    return ::setsockopt( my->_sock.native_handle(), SOL_UDP, UDP_GRO, &on, sizeof(on) ) == 0;
+#else
+    return !enable;
+#endif
+  }
+#else // one datagram per call
+  size_t udp_socket::receive_many( datagram* d, size_t count ) {
+    if( count == 0 ) return 0;
+    d[0].received     = receive_from( d[0].data, d[0].size, d[0].endpoint );
+    d[0].segment_size = 0;
+    return 1;
+  }
+  size_t udp_socket::send_many( const datagram* d, size_t count ) {
+    for( size_t i = 0; i < count; ++i ) {
+      FC_ASSERT( d[i].segment_size == 0, "UDP segmentation offload is not supported on this platform" );
+      if( d[i].endpoint != fc::ip::endpoint() ) send_to( d[i].data, d[i].size, d[i].endpoint );
+      else my->_sock.send( boost::asio::buffer( d[i].data, d[i].size ) );
+    }
+    return count;
+  }
+  bool udp_socket::set_gro( bool enable ) {
+    return !enable;
+  }
+#endif
+
   void   udp_socket::close() {
     //my->_sock.cancel(); 
+    if( my->_reactor_ref && my->_sock.is_open() ) fc::thread::cancel_io( my->_reactor_ref, my->_sock.native_handle() );
     my->_sock.close();
   }
 
@@ -94,6 +312,7 @@ namespace fc {
   }
   void udp_socket::connect( const fc::ip::endpoint& e ) {
      my->_sock.connect( to_asio_ep(e) );
+     my->remember_endpoints();
   }
 
   void   udp_socket::set_multicast_enable_loopback( bool s )
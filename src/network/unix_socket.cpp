@@ -0,0 +1,274 @@
+#include <fc/network/unix_socket.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/asio.hpp>
+#include <fc/exception/exception.hpp>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  #include <sys/socket.h>
+  #include <sys/stat.h>
+  #include <sys/un.h>
+  #include <unistd.h>
+  #include <errno.h>
+  #include <string.h>
+#endif
+
+namespace fc {
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  typedef boost::asio::local::stream_protocol local_protocol;
+
+  class unix_socket::impl {
+    public:
+      impl()
+      :_sock( fc::asio::next_io_service() ),
+       _read_slot("fc::unix_socket::read"),_write_slot("fc::unix_socket::write"){}
+      ~impl(){
+        close();
+      }
+
+      void close() {
+        if( _sock.is_open() ) _sock.close();
+      }
+
+      local_protocol::socket     _sock;
+      fc::asio::completion_slot  _read_slot;
+      fc::asio::completion_slot  _write_slot;
+  };
+
+  unix_socket::unix_socket()
+  :my( new impl() ){}
+  unix_socket::~unix_socket(){}
+
+  void unix_socket::connect_to( const fc::path& p ) {
+    fc::asio::tcp::connect( my->_sock, local_protocol::endpoint( p.string() ), my->_write_slot );
+    my->_sock.non_blocking(true);
+  }
+
+  size_t unix_socket::readsome( char* buf, size_t len ) {
+    return fc::asio::read_some( my->_sock, boost::asio::buffer( buf, len ), my->_read_slot );
+  }
+  size_t unix_socket::readvsome( const mutable_buffer* bufs, size_t count ) {
+    std::vector<boost::asio::mutable_buffer> seq;
+    seq.reserve( count );
+    for( size_t i = 0; i < count; ++i )
+      if( bufs[i].size ) seq.push_back( boost::asio::mutable_buffer( bufs[i].data, bufs[i].size ) );
+    return fc::asio::read_some( my->_sock, seq, my->_read_slot );
+  }
+  bool unix_socket::eof()const {
+    return !my->_sock.is_open();
+  }
+
+  size_t unix_socket::writesome( const char* buf, size_t len ) {
+    return fc::asio::write_some( my->_sock, boost::asio::buffer( buf, len ), my->_write_slot );
+  }
+  size_t unix_socket::writevsome( const const_buffer* bufs, size_t count ) {
+    std::vector<boost::asio::const_buffer> seq;
+    seq.reserve( count );
+    for( size_t i = 0; i < count; ++i )
+      if( bufs[i].size ) seq.push_back( boost::asio::const_buffer( bufs[i].data, bufs[i].size ) );
+    return fc::asio::write_some( my->_sock, seq, my->_write_slot );
+  }
+  ostream& unix_socket::writev( const const_buffer* bufs, size_t count ) {
+    std::vector<boost::asio::const_buffer> seq;
+    seq.reserve( count );
+    for( size_t i = 0; i < count; ++i )
+      if( bufs[i].size ) seq.push_back( boost::asio::const_buffer( bufs[i].data, bufs[i].size ) );
+    if( !seq.empty() ) fc::asio::write( my->_sock, seq, my->_write_slot );
+    return *this;
+  }
+  void unix_socket::flush() {}
+  void unix_socket::close() {
+    my->close();
+  }
+  bool unix_socket::is_open()const {
+    return my->_sock.is_open();
+  }
+
+  void unix_socket::send_fd( int fd ) {
+    char     byte = 0;
+    iovec    iov  = { &byte, 1 };
+    char     ctrl[CMSG_SPACE(sizeof(int))];
+    msghdr   msg;
+    memset( &msg, 0, sizeof(msg) );
+    memset( ctrl, 0, sizeof(ctrl) );
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+    cmsghdr* c    = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type  = SCM_RIGHTS;
+    c->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy( CMSG_DATA(c), &fd, sizeof(int) );
+
+    while( true ) {
+      ssize_t r = ::sendmsg( my->_sock.native_handle(), &msg, MSG_NOSIGNAL | MSG_DONTWAIT );
+      if( r == 1 ) return;
+      if( r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ) fc::asio::wait_writable( my->_sock, my->_write_slot );
+      else if( r < 0 && errno != EINTR )
+        FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+    }
+  }
+
+  int unix_socket::receive_fd() {
+    char     byte = 0;
+    iovec    iov  = { &byte, 1 };
+    char     ctrl[CMSG_SPACE(sizeof(int))];
+    msghdr   msg;
+    while( true ) {
+      memset( &msg, 0, sizeof(msg) );
+      msg.msg_iov        = &iov;
+      msg.msg_iovlen     = 1;
+      msg.msg_control    = ctrl;
+      msg.msg_controllen = sizeof(ctrl);
+      ssize_t r = ::recvmsg( my->_sock.native_handle(), &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC );
+      if( r == 0 ) FC_THROW_EXCEPTION( eof_exception, "" );
+      if( r > 0 ) break;
+      if( errno == EAGAIN || errno == EWOULDBLOCK ) fc::asio::wait_readable( my->_sock, my->_read_slot );
+      else if( errno != EINTR )
+        FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+    }
+    int fd = -1;
+    for( cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c) ) {
+      if( c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS ) continue;
+      // close any descriptor beyond the first, the peer sends one at a time
+      size_t n = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for( size_t i = 0; i < n; ++i ) {
+        int f;
+        memcpy( &f, CMSG_DATA(c) + i * sizeof(int), sizeof(int) );
+        if( fd < 0 ) fd = f;
+        else ::close( f );
+      }
+    }
+    if( msg.msg_flags & MSG_CTRUNC ) {
+      // the kernel dropped descriptors that did not fit, do not leave half of them open
+      if( fd >= 0 ) ::close( fd );
+      FC_THROW_EXCEPTION( exception, "the control message carrying the descriptor was truncated" );
+    }
+    if( fd < 0 ) FC_THROW_EXCEPTION( exception, "no file descriptor was received" );
+    return fd;
+  }
+
+  void unix_socket::send_socket( tcp_socket& s ) {
+    send_fd( s.native_handle() );
+    s.detach();
+  }
+  void unix_socket::receive_socket( tcp_socket& s ) {
+    int fd = receive_fd();
+    try {
+      s.assign( fd );
+    } catch ( ... ) {
+      ::close(fd);
+      throw;
+    }
+  }
+
+
+  class unix_server::impl {
+    public:
+      impl()
+      :_accept( fc::asio::next_io_service() ){}
+      ~impl(){
+        close();
+      }
+
+      void close() {
+        if( !_accept.is_open() ) return;
+        _accept.close();
+        ::unlink( _path.c_str() );
+      }
+
+      local_protocol::acceptor _accept;
+      std::string              _path;
+  };
+
+  unix_server::unix_server(){}
+  unix_server::~unix_server(){}
+
+  void unix_server::close() {
+    if( my ) my->close();
+  }
+
+  bool unix_server::accept( unix_socket& s ) {
+    try {
+      if( !my || !my->_accept.is_open() ) return false;
+      fc::asio::tcp::accept( my->_accept, s.my->_sock, s.my->_read_slot );
+      s.my->_sock.non_blocking(true);
+      return true;
+    } FC_RETHROW_EXCEPTIONS( warn, "Unable to accept connection on unix socket." );
+  }
+
+  namespace detail {
+    /** unlinks path if it is a socket no server listens on any more */
+    void remove_stale_socket( const std::string& path ) {
+      struct stat st;
+      if( ::lstat( path.c_str(), &st ) != 0 ) return;
+      if( !S_ISSOCK( st.st_mode ) )
+        FC_THROW_EXCEPTION( exception, "${path} exists and is not a socket", ("path",path) );
+
+      sockaddr_un addr;
+      memset( &addr, 0, sizeof(addr) );
+      addr.sun_family = AF_UNIX;
+      if( path.size() >= sizeof(addr.sun_path) )
+        FC_THROW_EXCEPTION( exception, "${path} is too long for a unix socket", ("path",path) );
+      memcpy( addr.sun_path, path.c_str(), path.size() );
+
+      int fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+      if( fd < 0 ) FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(errno))) );
+      int r   = ::connect( fd, (sockaddr*)&addr, sizeof(addr) );
+      int err = errno;
+      ::close( fd );
+      if( r == 0 || err == EAGAIN )
+        FC_THROW_EXCEPTION( exception, "a server is listening on ${path}", ("path",path) );
+      if( err != ECONNREFUSED )
+        FC_THROW_EXCEPTION( exception, "${path}: ${message}", ("path",path)("message", fc::string(strerror(err))) );
+      ::unlink( path.c_str() );
+    }
+  }
+
+  void unix_server::listen( const fc::path& p ) {
+    my.reset( new impl() );
+    detail::remove_stale_socket( p.string() );
+    my->_path = p.string();
+    local_protocol::endpoint ep( my->_path );
+    my->_accept.open( ep.protocol() );
+    my->_accept.bind( ep );
+    my->_accept.listen();
+  }
+
+#else // no local sockets on this platform
+
+  class unix_socket::impl {};
+  class unix_server::impl {};
+
+  unix_socket::unix_socket(){}
+  unix_socket::~unix_socket(){}
+  void unix_socket::connect_to( const fc::path& ) {
+    FC_THROW_EXCEPTION( exception, "unix domain sockets are not supported on this platform" );
+  }
+  size_t   unix_socket::readsome( char*, size_t )                         { FC_THROW_EXCEPTION( eof_exception, "" ); }
+  size_t   unix_socket::readvsome( const mutable_buffer*, size_t )        { FC_THROW_EXCEPTION( eof_exception, "" ); }
+  bool     unix_socket::eof()const                                        { return true; }
+  size_t   unix_socket::writesome( const char*, size_t )                  { FC_THROW_EXCEPTION( eof_exception, "" ); }
+  size_t   unix_socket::writevsome( const const_buffer*, size_t )         { FC_THROW_EXCEPTION( eof_exception, "" ); }
+  ostream& unix_socket::writev( const const_buffer*, size_t )             { FC_THROW_EXCEPTION( eof_exception, "" ); }
+  void     unix_socket::flush(){}
+  void     unix_socket::close(){}
+  bool     unix_socket::is_open()const                                    { return false; }
+  void     unix_socket::send_fd( int )                                    { FC_THROW_EXCEPTION( eof_exception, "" ); }
+  int      unix_socket::receive_fd()                                      { FC_THROW_EXCEPTION( eof_exception, "" ); }
+  void     unix_socket::send_socket( tcp_socket& )                        { FC_THROW_EXCEPTION( eof_exception, "" ); }
+  void     unix_socket::receive_socket( tcp_socket& )                     { FC_THROW_EXCEPTION( eof_exception, "" ); }
+
+  unix_server::unix_server(){}
+  unix_server::~unix_server(){}
+  void unix_server::close(){}
+  bool unix_server::accept( unix_socket& ) { return false; }
+  void unix_server::listen( const fc::path& ) {
+    FC_THROW_EXCEPTION( exception, "unix domain sockets are not supported on this platform" );
+  }
+
+#endif
+
+} // namespace fc
@@ -99,6 +99,15 @@ namespace fc {
       _compl->on_complete(s,_exceptp);
     }
   }
+  void promise_base::_reset() {
+    { synchronized(_spin_yield) 
+      _ready          = false;
+      _canceled       = false;
+      _blocked_thread = nullptr;
+      _timeout        = time_point::maximum();
+      _exceptp.reset();
+    }
+  }
   void promise_base::_on_complete( detail::completion_handler* c ) {
     { synchronized(_spin_yield) 
         delete _compl; 
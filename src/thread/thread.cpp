@@ -157,6 +157,7 @@ namespace fc {
       {
          wlog( "thread canceled" );
       }
+      my->shutdown_reactor();
       delete my->current;
       my->current = 0;
    }
@@ -246,10 +247,145 @@ namespace fc {
    }
 
    void thread::poke() {
+     if( my->epoll_fd >= 0 ) {
+       my->wake_io();
+       return;
+     }
      boost::unique_lock<boost::mutex> lock(my->task_ready_mutex);
      my->task_ready.notify_one();
    }
 
+   bool thread::enable_io_reactor() {
+     const char* env = std::getenv( "FC_IO_ENGINE" );
+     if( env && fc::string(env) == "asio" )  return false;
+     if( env && fc::string(env) == "uring" ) return enable_io_reactor( uring_engine );
+     return enable_io_reactor( epoll_engine );
+   }
+   bool thread::enable_io_reactor( io_engine e ) {
+     BOOST_ASSERT( is_current() );
+     if( e == asio_engine ) return false;
+     if( e == uring_engine && my->enable_io_uring() ) return true;
+     return my->enable_io_reactor();
+   }
+   bool thread::has_io_reactor()const {
+     return my->epoll_fd >= 0;
+   }
+   thread::io_engine thread::get_io_engine()const {
+#ifdef FC_HAS_IO_URING
+     if( my->ring ) return uring_engine;
+#endif
+     return my->epoll_fd >= 0 ? epoll_engine : asio_engine;
+   }
+
+#ifdef FC_HAS_IO_URING
+   static size_t uring_io( thread& t, thread_d* my, uint8_t op, int fd, const char* buf, size_t len, int64_t offset, const char* desc ) {
+     FC_ASSERT( my->ring );
+     int r = 0;
+     while( true ) {
+       uring_request req;
+       my->queue_uring( op, fd, buf, len, offset, req );
+       r = my->wait_uring( req, desc );
+       // depending on the kernel, O_NONBLOCK sockets may fail instead of being polled
+       if( r != -EAGAIN ) break;
+       t.wait_io( fd, op != IORING_OP_READ );
+     }
+     if( r < 0 ) {
+       if( r == -ECANCELED ) FC_THROW_EXCEPTION( canceled_exception, "" );
+       FC_THROW_EXCEPTION( exception, "${message}", ("message", fc::string(strerror(-r))) );
+     }
+     return size_t(r);
+   }
+#endif
+
+   size_t thread::uring_read( int fd, char* buf, size_t len, int64_t offset ) {
+     BOOST_ASSERT( is_current() );
+#ifdef FC_HAS_IO_URING
+     return uring_io( *this, my, IORING_OP_READ, fd, buf, len, offset, "fc::thread::uring_read" );
+#else
+     FC_THROW_EXCEPTION( assert_exception, "io_uring is not supported" );
+#endif
+   }
+   size_t thread::uring_write( int fd, const char* buf, size_t len, int64_t offset ) {
+     BOOST_ASSERT( is_current() );
+#ifdef FC_HAS_IO_URING
+     return uring_io( *this, my, IORING_OP_WRITE, fd, buf, len, offset, "fc::thread::uring_write" );
+#else
+     FC_THROW_EXCEPTION( assert_exception, "io_uring is not supported" );
+#endif
+   }
+   size_t thread::uring_send( int fd, const char* buf, size_t len ) {
+     BOOST_ASSERT( is_current() );
+#ifdef FC_HAS_IO_URING
+     return uring_io( *this, my, IORING_OP_SEND, fd, buf, len, 0, "fc::thread::uring_send" );
+#else
+     FC_THROW_EXCEPTION( assert_exception, "io_uring is not supported" );
+#endif
+   }
+
+   bool thread::register_io_buffers( const std::vector< std::pair<char*,size_t> >& bufs ) {
+     BOOST_ASSERT( is_current() );
+#ifdef FC_HAS_IO_URING
+     if( !my->ring ) return false;
+     std::vector<iovec> iov( bufs.size() );
+     for( uint32_t i = 0; i < bufs.size(); ++i ) {
+       iov[i].iov_base = bufs[i].first;
+       iov[i].iov_len  = bufs[i].second;
+     }
+     if( !my->ring->register_buffers( iov.data(), unsigned(iov.size()) ) ) {
+       my->ring_buffers.clear();
+       return false;
+     }
+     my->ring_buffers = fc::move(iov);
+     return true;
+#else
+     return false;
+#endif
+   }
+
+   void thread::wait_io( int fd, bool write, const time_point& timeout ) {
+     BOOST_ASSERT( is_current() );
+     FC_ASSERT( my->epoll_fd >= 0 );
+
+     promise<void>::ptr p( new promise<void>( write ? "fc::thread::wait_io write" : "fc::thread::wait_io read" ) );
+     my->watch_io( fd, write, p );
+     try {
+       p->wait_until( timeout );
+     } catch ( ... ) {
+       my->unwatch_io( fd, write, p );
+       throw;
+     }
+   }
+
+   void thread::cancel_io( int fd ) {
+     if( my->epoll_fd < 0 ) return;
+     if( !is_current() ) {
+       cancel_io( my->reactor, fd );
+       return;
+     }
+     my->unwatch_io( fd, false, promise<void>::ptr() );
+     my->unwatch_io( fd, true, promise<void>::ptr() );
+   }
+
+   thread::reactor_ptr thread::get_io_reactor()const {
+     return my->reactor;
+   }
+
+   void thread::cancel_io( const reactor_ptr& r, int fd ) {
+     if( !r ) return;
+     promise<void>::ptr p;
+     {
+       boost::unique_lock<boost::mutex> lock( r->mutex );
+       if( !r->reactor ) return;
+       if( r->reactor != current().my ) {
+         p.reset( new promise<void>( "fc::thread::cancel_io" ) );
+         r->cancels.push_back( std::make_pair( fd, p ) );
+         r->reactor->wake_io();
+       }
+     }
+     if( p ) p->wait();
+     else    current().cancel_io( fd );
+   }
+
    void thread::async_task( task_base* t, const priority& p, const time_point& tp, const char* desc ) {
       assert(my);
       t->_when = tp;
@@ -263,6 +399,10 @@ namespace fc {
       // to aquire the lock and therefore there should be no contention on this lock except
       // when *this thread is about to block on a wait condition.  
       if( this != &current() &&  !stale_head ) { 
+          if( my->epoll_fd >= 0 ) {
+            my->wake_io();
+            return;
+          }
           boost::unique_lock<boost::mutex> lock(my->task_ready_mutex);
           my->task_ready.notify_one();
       }
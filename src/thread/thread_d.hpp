@@ -7,6 +7,22 @@
 #include <boost/thread.hpp>
 #include <boost/atomic.hpp>
 #include <vector>
+
+#if defined(__linux__)
+  #define FC_HAS_EPOLL_REACTOR 1
+  #include <sys/epoll.h>
+  #include <sys/eventfd.h>
+  #include <sys/socket.h>
+  #include <unistd.h>
+  #include <errno.h>
+  #include <string.h>
+  #include <unordered_map>
+  #include <linux/io_uring.h>
+  #ifdef IORING_FEAT_FAST_POLL
+    #define FC_HAS_IO_URING 1
+    #include "uring.hpp"
+  #endif
+#endif
 //#include <fc/logger.hpp>
 
 namespace fc {
@@ -15,6 +31,39 @@ namespace fc {
             return a->resume_time > b->resume_time;
         }
     };
+    /**
+     *  Shared by a thread_d and the objects waiting on its reactor, other threads hand
+     *  it their cancel_io() requests rather than posting tasks that would never run
+     *  once the thread has exited.
+     */
+    class thread::reactor_ref {
+      public:
+        reactor_ref( thread_d* d ):reactor(d){}
+
+        boost::mutex mutex;
+        /** null once the reactor has shut down */
+        thread_d*    reactor;
+        std::vector< std::pair<int,promise<void>::ptr> > cancels;
+    };
+
+#ifdef FC_HAS_IO_URING
+    /**
+     *  An operation handed to the ring.  It lives on the stack of the fiber that
+     *  queued it, which does not return before its completion has been reaped since
+     *  the kernel may use the buffer until then.
+     */
+    struct uring_request {
+       uring_request():result(0),done(false),prev(nullptr),next(nullptr){}
+       int               result;
+       bool              done;
+       /** set by the fiber every time it waits for the completion */
+       promise<int>::ptr waiter;
+       /** in the list of requests in flight */
+       uring_request*    prev;
+       uring_request*    next;
+    };
+#endif
+
     class thread_d {
 
         public:
@@ -26,13 +75,33 @@ namespace fc {
              pt_head(0),
              ready_head(0),
              ready_tail(0),
-             blocked(0)
+             blocked(0),
+             epoll_fd(-1),
+             wake_fd(-1),
+             ring_event_fd(-1)
             { 
+#ifdef FC_HAS_IO_URING
+              ring_inflight = nullptr;
+#endif
               static boost::atomic<int> cnt(0);
               name = fc::string("th_") + char('a'+cnt++); 
 //              printf("thread=%p\n",this);
             }
             ~thread_d(){
+#ifdef FC_HAS_IO_URING
+             if( ring ) {
+               // the buffers of the requests still in flight are on the fiber stacks
+               // freed below, so they are canceled and waited for first
+               for( uring_request* r = ring_inflight; r; r = r->next ) queue_uring_cancel( *r );
+               while( ring_inflight ) {
+                 ring->submit_and_wait();
+                 ring->reap( [this]( uint64_t ud, int res ) {
+                   if( ud ) finish_uring( *reinterpret_cast<uring_request*>(ud), res );
+                 } );
+               }
+               ring.reset();
+             }
+#endif
               delete current;
               fc::context* temp;
               while (ready_head)
@@ -56,6 +125,12 @@ namespace fc {
               }
               */
               ilog("");
+              shutdown_reactor();
+#ifdef FC_HAS_EPOLL_REACTOR
+             if( epoll_fd >= 0 ) ::close(epoll_fd);
+             if( wake_fd >= 0 )  ::close(wake_fd);
+             if( ring_event_fd >= 0 ) ::close(ring_event_fd);
+#endif
              if (boost_thread)
              {
                boost_thread->detach();
@@ -85,6 +160,31 @@ namespace fc {
 
            fc::context*             blocked;
 
+           /**
+            *  When the io reactor is enabled the thread sleeps in epoll_wait() rather
+            *  than on task_ready, other threads wake it by writing to wake_fd.
+            */
+           int                      epoll_fd;
+           int                      wake_fd;
+#ifdef FC_HAS_EPOLL_REACTOR
+           struct io_waiter {
+              io_waiter():registered(false){}
+              promise<void>::ptr readable;
+              promise<void>::ptr writable;
+              bool               registered;
+           };
+           std::unordered_map<int,io_waiter> io_waiters;
+#endif
+           /** set by enable_io_reactor() */
+           thread::reactor_ptr      reactor;
+           /** signaled by the kernel when io_uring completions are posted */
+           int                      ring_event_fd;
+#ifdef FC_HAS_IO_URING
+           std::unique_ptr<uring>   ring;
+           std::vector<iovec>       ring_buffers;
+           uring_request*           ring_inflight;
+#endif
+
 
 
 #if 0
@@ -369,6 +469,7 @@ namespace fc {
                 // if I have something else to do other than
                 // process tasks... do it.
                 if( ready_head ) { 
+                   if( epoll_fd >= 0 ) poll_io( time_point::min() );
                    pt_push_back( current ); 
                    start_next_fiber(false);  
                    continue;
@@ -376,6 +477,17 @@ namespace fc {
 
                 clear_free_list();
 
+                if( epoll_fd >= 0 ) {
+                  // posting threads write to wake_fd after queuing, so there is no
+                  // need to hold task_ready_mutex across the wait
+                  if( has_next_task() ) continue;
+                  time_point timeout_time = check_for_timeouts();
+                  if( done ) return;
+                  if( timeout_time != time_point::min() ) 
+                    poll_io( timeout_time );
+                  continue;
+                }
+
                 { // lock scope
                   boost::unique_lock<boost::mutex> lock(task_ready_mutex);
                   if( has_next_task() ) continue;
@@ -427,6 +539,294 @@ namespace fc {
         return time_point::min();
     }
 
+    bool enable_io_reactor() {
+#ifdef FC_HAS_EPOLL_REACTOR
+        if( epoll_fd >= 0 ) return true;
+        int efd = epoll_create1( EPOLL_CLOEXEC );
+        if( efd < 0 ) return false;
+        int wfd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+        if( wfd < 0 ) { ::close(efd); return false; }
+
+        epoll_event ev;
+        ev.events  = EPOLLIN;
+        ev.data.fd = wfd;
+        if( epoll_ctl( efd, EPOLL_CTL_ADD, wfd, &ev ) != 0 ) {
+          ::close(efd); ::close(wfd);
+          return false;
+        }
+        wake_fd  = wfd;
+        epoll_fd = efd;
+        reactor  = std::make_shared<thread::reactor_ref>( this );
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool enable_io_uring() {
+#ifdef FC_HAS_IO_URING
+        if( ring ) return true;
+        if( !enable_io_reactor() ) return false;
+
+        int efd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+        if( efd < 0 ) return false;
+        std::unique_ptr<uring> r( new uring() );
+        epoll_event ev;
+        ev.events  = EPOLLIN;
+        ev.data.fd = efd;
+        if( !r->init( 256, efd ) || epoll_ctl( epoll_fd, EPOLL_CTL_ADD, efd, &ev ) != 0 ) {
+          ::close(efd);
+          return false;
+        }
+        ring_event_fd = efd;
+        ring = fc::move(r);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+#ifdef FC_HAS_IO_URING
+    io_uring_sqe* get_uring_sqe() {
+        io_uring_sqe* sqe = ring->get_sqe();
+        if( !sqe ) {
+          ring->submit();
+          sqe = ring->get_sqe();
+          if( !sqe ) FC_THROW_EXCEPTION( exception, "io_uring submission queue is full" );
+        }
+        return sqe;
+    }
+
+    /**
+     *  Queues an operation on the ring, it is handed to the kernel together with
+     *  every other queued operation the next time the thread polls for io.
+     *  r stays in ring_inflight until the completion has been reaped.
+     */
+    void queue_uring( uint8_t op, int fd, const char* buf, size_t len, int64_t offset, 
+                      uring_request& r ) {
+        io_uring_sqe* sqe = get_uring_sqe();
+        sqe->opcode    = op;
+        sqe->fd        = fd;
+        sqe->addr      = reinterpret_cast<uint64_t>(buf);
+        sqe->len       = uint32_t(len);
+        sqe->off       = uint64_t(offset);
+        if( op == IORING_OP_SEND ) sqe->msg_flags = MSG_NOSIGNAL;
+        if( op == IORING_OP_READ ) {
+          // reads into a registered buffer avoid mapping the pages for every request
+          for( uint32_t i = 0; i < ring_buffers.size(); ++i ) {
+            const char* b = static_cast<const char*>(ring_buffers[i].iov_base);
+            if( buf >= b && buf + len <= b + ring_buffers[i].iov_len ) {
+              sqe->opcode    = IORING_OP_READ_FIXED;
+              sqe->buf_index = uint16_t(i);
+              break;
+            }
+          }
+        }
+        sqe->user_data = reinterpret_cast<uint64_t>(&r);
+
+        r.prev = nullptr;
+        r.next = ring_inflight;
+        if( ring_inflight ) ring_inflight->prev = &r;
+        ring_inflight = &r;
+    }
+
+    /** asks the kernel to complete r early, with -ECANCELED unless it already finished */
+    void queue_uring_cancel( uring_request& r ) {
+        io_uring_sqe* sqe = get_uring_sqe();
+        sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+        sqe->fd        = -1;
+        sqe->addr      = reinterpret_cast<uint64_t>(&r);
+        sqe->user_data = 0; // its own completion is ignored
+    }
+
+    void finish_uring( uring_request& r, int res ) {
+        if( r.prev ) r.prev->next  = r.next;
+        else         ring_inflight = r.next;
+        if( r.next ) r.next->prev  = r.prev;
+        r.result = res;
+        r.done   = true;
+    }
+
+    unsigned reap_uring() {
+        return ring->reap( [this]( uint64_t ud, int res ) {
+          if( !ud ) return;
+          uring_request& r = *reinterpret_cast<uring_request*>(ud);
+          finish_uring( r, res );
+          if( r.waiter ) r.waiter->set_value( res );
+        } );
+    }
+
+    /**
+     *  Blocks the current fiber until r has completed.  If the fiber is canceled in
+     *  the meantime r is canceled too, and the whole thread waits for its completion
+     *  before the exception is passed on, a quitting thread cannot block fibers again.
+     */
+    int wait_uring( uring_request& r, const char* desc ) {
+        r.waiter.reset( new promise<int>( desc ) );
+        try {
+          return r.waiter->wait();
+        } catch ( ... ) {
+          if( !r.done ) {
+            queue_uring_cancel( r );
+            while( !r.done ) {
+              ring->submit_and_wait();
+              reap_uring();
+            }
+          }
+          throw;
+        }
+    }
+#endif
+
+    /** runs the cancel_io() requests other threads queued on reactor */
+    void cancel_queued_io() {
+        std::vector< std::pair<int,promise<void>::ptr> > c;
+        {
+          boost::unique_lock<boost::mutex> lock( reactor->mutex );
+          if( reactor->cancels.empty() ) return;
+          c.swap( reactor->cancels );
+        }
+        for( size_t i = 0; i < c.size(); ++i ) {
+          unwatch_io( c[i].first, false, promise<void>::ptr() );
+          unwatch_io( c[i].first, true, promise<void>::ptr() );
+          c[i].second->set_value();
+        }
+    }
+
+    /**
+     *  Detaches reactor once no fiber can wait on it anymore, objects that outlive the
+     *  thread then stop calling into it.
+     */
+    void shutdown_reactor() {
+        if( !reactor ) return;
+        std::vector< std::pair<int,promise<void>::ptr> > c;
+        {
+          boost::unique_lock<boost::mutex> lock( reactor->mutex );
+          reactor->reactor = nullptr;
+          c.swap( reactor->cancels );
+        }
+        for( size_t i = 0; i < c.size(); ++i ) c[i].second->set_value();
+        reactor.reset();
+    }
+
+    /**
+     *  Called by other threads after posting a task, wakes up poll_io()
+     */
+    void wake_io() {
+#ifdef FC_HAS_EPOLL_REACTOR
+        uint64_t one = 1;
+        ssize_t r = ::write( wake_fd, &one, sizeof(one) );
+        (void)r; // EAGAIN means the counter is already non zero and a wakeup is pending
+#endif
+    }
+
+#ifdef FC_HAS_EPOLL_REACTOR
+    void update_io_registration( int fd, io_waiter& w ) {
+        epoll_event ev;
+        ev.events  = EPOLLONESHOT;
+        ev.data.fd = fd;
+        if( w.readable ) ev.events |= EPOLLIN | EPOLLRDHUP;
+        if( w.writable ) ev.events |= EPOLLOUT;
+
+        if( !w.readable && !w.writable ) {
+          if( w.registered ) epoll_ctl( epoll_fd, EPOLL_CTL_DEL, fd, &ev );
+          io_waiters.erase(fd);
+          return;
+        }
+        if( w.registered ) {
+          if( epoll_ctl( epoll_fd, EPOLL_CTL_MOD, fd, &ev ) == 0 ) return;
+          // the fd was closed and reopened since the last wait
+          w.registered = false;
+        }
+        if( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, fd, &ev ) != 0 ) {
+          int err = errno;
+          promise<void>::ptr r = w.readable, wr = w.writable;
+          io_waiters.erase(fd);
+          auto e = std::make_shared<fc::exception>( FC_LOG_MESSAGE( error, "epoll_ctl: ${message}", ("message", fc::string(strerror(err)) ) ) );
+          if( r )  r->set_exception( e );
+          if( wr ) wr->set_exception( e );
+          return;
+        }
+        w.registered = true;
+    }
+#endif
+
+    void watch_io( int fd, bool write, const promise<void>::ptr& p ) {
+#ifdef FC_HAS_EPOLL_REACTOR
+        io_waiter& w = io_waiters[fd];
+        promise<void>::ptr& slot = write ? w.writable : w.readable;
+        if( slot ) FC_THROW_EXCEPTION( assert_exception, "another fiber is already waiting on fd ${fd}", ("fd",fd) );
+        slot = p;
+        update_io_registration( fd, w );
+#endif
+    }
+
+    /**
+     *  Removes p from the waiters on fd if it is still there, for example after
+     *  a timeout. If p is null any waiter is canceled.
+     */
+    void unwatch_io( int fd, bool write, const promise<void>::ptr& p ) {
+#ifdef FC_HAS_EPOLL_REACTOR
+        auto itr = io_waiters.find(fd);
+        if( itr == io_waiters.end() ) return;
+        promise<void>::ptr& slot = write ? itr->second.writable : itr->second.readable;
+        if( !slot || (p && slot != p) ) return;
+        promise<void>::ptr w = slot;
+        slot.reset();
+        update_io_registration( fd, itr->second );
+        if( !p ) w->set_exception( std::make_shared<canceled_exception>() );
+#endif
+    }
+
+    /**
+     *  Waits up to @param until for io events and unblocks the fibers waiting
+     *  on them. time_point::min() polls without blocking.
+     */
+    void poll_io( const time_point& until ) {
+#ifdef FC_HAS_EPOLL_REACTOR
+        int timeout_ms = -1;
+        if( until != time_point::maximum() ) {
+          time_point now = time_point::now();
+          timeout_ms = until <= now ? 0 : int( ((until - now).count() + 999) / 1000 );
+        }
+
+#ifdef FC_HAS_IO_URING
+        if( ring ) {
+          ring->submit();
+          if( reap_uring() ) timeout_ms = 0;
+        }
+#endif
+
+        epoll_event events[64];
+        int n = epoll_wait( epoll_fd, events, 64, timeout_ms );
+        for( int i = 0; i < n; ++i ) {
+          int fd = events[i].data.fd;
+          if( fd == wake_fd || fd == ring_event_fd ) {
+            uint64_t cnt;
+            ssize_t r = ::read( fd, &cnt, sizeof(cnt) );
+            (void)r;
+            if( fd == wake_fd ) cancel_queued_io();
+#ifdef FC_HAS_IO_URING
+            if( fd == ring_event_fd ) reap_uring();
+#endif
+            continue;
+          }
+          auto itr = io_waiters.find(fd);
+          if( itr == io_waiters.end() ) continue;
+
+          // one shot, the fd is disarmed until update_io_registration()
+          promise<void>::ptr r, w;
+          uint32_t ev = events[i].events;
+          if( ev & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP) ) std::swap( r, itr->second.readable );
+          if( ev & (EPOLLOUT | EPOLLERR | EPOLLHUP) )             std::swap( w, itr->second.writable );
+          update_io_registration( fd, itr->second );
+
+          if( r ) r->set_value();
+          if( w ) w->set_value();
+        }
+#endif
+    }
+
     void unblock( fc::context* c ) {
         if(  fc::thread::current().my != this ) {
           async( [=](){ unblock(c); } );
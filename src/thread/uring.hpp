@@ -0,0 +1,169 @@
+#pragma once
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+namespace fc {
+
+  /**
+   *  Minimal io_uring submission and completion queue driven through the
+   *  raw system calls so that no extra library is required.
+   *
+   *  A uring is owned by a single thread_d and is never touched from any other
+   *  thread, the only synchronization required is with the kernel.
+   */
+  class uring
+  {
+    public:
+      uring()
+      :ring_fd(-1),ring_ptr(nullptr),ring_len(0),sqes(nullptr),sqes_len(0),to_submit(0){}
+
+      ~uring() {
+        if( sqes )     munmap( sqes, sqes_len );
+        if( ring_ptr ) munmap( ring_ptr, ring_len );
+        if( ring_fd >= 0 ) ::close( ring_fd );
+      }
+
+      /**
+       *  @param event_fd is signaled by the kernel every time a completion is posted
+       *  @return false if io_uring is not available or the kernel is too old to poll
+       *          sockets internally (IORING_FEAT_FAST_POLL, linux 5.7)
+       */
+      bool init( unsigned entries, int event_fd ) {
+        io_uring_params p;
+        memset( &p, 0, sizeof(p) );
+        int fd = int( syscall( __NR_io_uring_setup, entries, &p ) );
+        if( fd < 0 ) return false;
+        ring_fd = fd;
+        if( !(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_FAST_POLL) )
+          return false;
+
+        // with IORING_FEAT_SINGLE_MMAP the submission and completion rings share one mapping
+        ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        if( cq_len > ring_len ) ring_len = cq_len;
+        void* r = mmap( 0, ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING );
+        if( r == MAP_FAILED ) return false;
+        ring_ptr = r;
+
+        sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+        void* s = mmap( 0, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES );
+        if( s == MAP_FAILED ) return false;
+        sqes = static_cast<io_uring_sqe*>(s);
+
+        char* base = static_cast<char*>(ring_ptr);
+        sq_head    = reinterpret_cast<unsigned*>( base + p.sq_off.head );
+        sq_tail    = reinterpret_cast<unsigned*>( base + p.sq_off.tail );
+        sq_mask    = *reinterpret_cast<unsigned*>( base + p.sq_off.ring_mask );
+        sq_array   = reinterpret_cast<unsigned*>( base + p.sq_off.array );
+        sq_entries = p.sq_entries;
+        cq_head    = reinterpret_cast<unsigned*>( base + p.cq_off.head );
+        cq_tail    = reinterpret_cast<unsigned*>( base + p.cq_off.tail );
+        cq_mask    = *reinterpret_cast<unsigned*>( base + p.cq_off.ring_mask );
+        cqes       = reinterpret_cast<io_uring_cqe*>( base + p.cq_off.cqes );
+
+        if( event_fd >= 0 &&
+            syscall( __NR_io_uring_register, fd, IORING_REGISTER_EVENTFD, &event_fd, 1 ) != 0 )
+          return false;
+        return true;
+      }
+
+      /**
+       *  @return a zeroed submission entry or nullptr if the queue is full.
+       *
+       *  The entry is only read by the kernel during submit() so it may be filled
+       *  in after it has been queued.
+       */
+      io_uring_sqe* get_sqe() {
+        unsigned head = __atomic_load_n( sq_head, __ATOMIC_ACQUIRE );
+        unsigned tail = *sq_tail;
+        if( tail - head >= sq_entries ) return nullptr;
+
+        unsigned idx = tail & sq_mask;
+        io_uring_sqe* sqe = &sqes[idx];
+        memset( sqe, 0, sizeof(*sqe) );
+        sq_array[idx] = idx;
+        __atomic_store_n( sq_tail, tail + 1, __ATOMIC_RELEASE );
+        ++to_submit;
+        return sqe;
+      }
+
+      /**
+       *  Hands every queued entry to the kernel with a single system call.
+       */
+      void submit() {
+        while( to_submit ) {
+          int r = int( syscall( __NR_io_uring_enter, ring_fd, to_submit, 0, 0, nullptr, 0 ) );
+          if( r < 0 ) {
+            if( errno == EINTR ) continue;
+            return; // EAGAIN / EBUSY, try again on the next poll
+          }
+          to_submit -= unsigned(r);
+          if( r == 0 ) return;
+        }
+      }
+
+      /**
+       *  Submits the queued entries and blocks until at least one completion is posted.
+       */
+      void submit_and_wait() {
+        while( true ) {
+          int r = int( syscall( __NR_io_uring_enter, ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0 ) );
+          if( r >= 0 ) { to_submit -= unsigned(r); return; }
+          if( errno != EINTR ) return;
+        }
+      }
+
+      /**
+       *  Calls f( user_data, result ) for every posted completion.
+       *  @return the number of completions
+       */
+      template<typename Functor>
+      unsigned reap( Functor&& f ) {
+        unsigned head  = *cq_head;
+        unsigned tail  = __atomic_load_n( cq_tail, __ATOMIC_ACQUIRE );
+        unsigned count = 0;
+        while( head != tail ) {
+          const io_uring_cqe& cqe = cqes[head & cq_mask];
+          f( cqe.user_data, cqe.res );
+          ++head;
+          ++count;
+        }
+        __atomic_store_n( cq_head, head, __ATOMIC_RELEASE );
+        return count;
+      }
+
+      /**
+       *  Registers the buffers used by IORING_OP_READ_FIXED, replacing any previously
+       *  registered set.
+       */
+      bool register_buffers( const iovec* iov, unsigned n ) {
+        syscall( __NR_io_uring_register, ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0 );
+        if( n == 0 ) return true;
+        return syscall( __NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, iov, n ) == 0;
+      }
+
+    private:
+      int           ring_fd;
+      void*         ring_ptr;
+      size_t        ring_len;
+      io_uring_sqe* sqes;
+      size_t        sqes_len;
+      unsigned      to_submit;
+
+      unsigned*     sq_head;
+      unsigned*     sq_tail;
+      unsigned      sq_mask;
+      unsigned*     sq_array;
+      unsigned      sq_entries;
+      unsigned*     cq_head;
+      unsigned*     cq_tail;
+      unsigned      cq_mask;
+      io_uring_cqe* cqes;
+  };
+
+} // namespace fc
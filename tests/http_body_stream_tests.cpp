@@ -0,0 +1,197 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/network/http/body_stream.hpp>
+#include <fc/exception/exception.hpp>
+#include <string>
+#include <string.h>
+
+using fc::http::body_istream;
+using fc::http::read_buffer;
+
+namespace {
+  /** hands out data at most step bytes at a time, then eof */
+  class chunked_source : public fc::istream {
+    public:
+      chunked_source( const std::string& d, size_t step = 7 ):_data(d),_pos(0),_step(step){}
+      virtual size_t readsome( char* buf, size_t len ) {
+        if( _pos == _data.size() ) FC_THROW_EXCEPTION( eof_exception, "" );
+        size_t n = std::min( std::min( len, _step ), _data.size() - _pos );
+        memcpy( buf, _data.data() + _pos, n );
+        _pos += n;
+        return n;
+      }
+      size_t consumed()const { return _pos; }
+    private:
+      std::string _data;
+      size_t      _pos;
+      size_t      _step;
+  };
+
+  /** collects what is written to it */
+  class string_sink : public fc::ostream {
+    public:
+      virtual size_t writesome( const char* buf, size_t len ) { data.append( buf, len ); return len; }
+      virtual void   close() {}
+      virtual void   flush() {}
+      std::string data;
+  };
+
+  std::string to_string( const std::vector<char>& v ) { return std::string( v.begin(), v.end() ); }
+
+  /** decodes the chunked body at the front of msg, read step bytes at a time */
+  std::string decode_chunked( const std::string& msg, size_t step, std::string* rest = nullptr ) {
+    read_buffer    buf;
+    chunked_source src( msg, step );
+    body_istream   in( buf, src, body_istream::chunked );
+    std::vector<char> out;
+    in.read_all( out );
+    BOOST_CHECK( in.done() );
+    if( rest ) *rest = std::string( buf.data(), buf.size() ) + msg.substr( src.consumed() );
+    return to_string( out );
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(body_stream_tests)
+
+BOOST_AUTO_TEST_CASE(read_all_takes_buffered_bytes_first)
+{
+  read_buffer    buf;
+  chunked_source src( "world, and more" );
+  fc::mutable_buffer b = buf.prepare( 1024 );
+  memcpy( b.data, "hello ", 6 );
+  buf.commit( 6 );
+
+  body_istream in( buf, src, body_istream::content_length, 11 );
+  std::vector<char> out;
+  in.read_all( out );
+  BOOST_CHECK_EQUAL( to_string( out ), "hello world" );
+  BOOST_CHECK( in.done() );
+  // nothing after the body is read
+  BOOST_CHECK_EQUAL( src.consumed(), 5u );
+}
+
+BOOST_AUTO_TEST_CASE(read_all_rejects_a_long_content_length_before_reading)
+{
+  read_buffer    buf;
+  chunked_source src( std::string( 100, 'x' ) );
+  body_istream   in( buf, src, body_istream::content_length, 100 );
+  std::vector<char> out;
+  BOOST_CHECK_THROW( in.read_all( out, 99 ), fc::out_of_range_exception );
+  BOOST_CHECK_EQUAL( src.consumed(), 0u );
+  BOOST_CHECK( out.empty() );
+
+  // one that fits exactly is read
+  in.read_all( out, 100 );
+  BOOST_CHECK_EQUAL( out.size(), 100u );
+}
+
+BOOST_AUTO_TEST_CASE(read_all_limits_bodies_without_a_length)
+{
+  {
+    read_buffer    buf;
+    chunked_source src( std::string( 10000, 'x' ) );
+    body_istream   in( buf, src, body_istream::until_eof );
+    std::vector<char> out;
+    BOOST_CHECK_THROW( in.read_all( out, 9999 ), fc::out_of_range_exception );
+  }
+  {
+    read_buffer    buf;
+    chunked_source src( std::string( 10000, 'x' ) );
+    body_istream   in( buf, src, body_istream::until_eof );
+    std::vector<char> out;
+    in.read_all( out, 10000 );
+    BOOST_CHECK_EQUAL( out.size(), 10000u );
+    BOOST_CHECK( in.done() );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(decodes_chunks_read_a_byte_at_a_time)
+{
+  const std::string msg = "5\r\nhello\r\n"
+                          "7;name=\"value\"\r\n, world\r\n"
+                          "A \r\n0123456789\r\n"
+                          "0\r\n"
+                          "Trailer: field\r\n"
+                          "\r\n"
+                          "GET / HTTP/1.1\r\n";
+  for( size_t step = 1; step <= msg.size(); step += 6 ) {
+    std::string rest;
+    BOOST_CHECK_EQUAL( decode_chunked( msg, step, &rest ), "hello, world0123456789" );
+    // the next message is left alone
+    BOOST_CHECK_EQUAL( rest, "GET / HTTP/1.1\r\n" );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(decodes_bare_newlines_and_upper_case_sizes)
+{
+  BOOST_CHECK_EQUAL( decode_chunked( "1A\n" + std::string( 26, 'z' ) + "\n0\n\n", 5 ), std::string( 26, 'z' ) );
+  BOOST_CHECK_EQUAL( decode_chunked( "0\r\n\r\n", 3 ), "" );
+}
+
+BOOST_AUTO_TEST_CASE(rejects_malformed_chunks)
+{
+  const char* bad[] = {
+    "x\r\nhello\r\n0\r\n\r\n",           // no size
+    "5x\r\nhello\r\n0\r\n\r\n",          // garbage after the size
+    "5\r\nhelloXX\r\n0\r\n\r\n",         // no CRLF after the data
+    "1000000000000000\r\n",                // 16 hex digits
+    "5\r\nhel",                            // closed in the data
+    "5\r\nhello\r\n0\r\n",                 // closed in the trailer
+    "5"                                     // closed in the size line
+  };
+  for( size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i ) {
+    read_buffer    buf;
+    chunked_source src( bad[i] );
+    body_istream   in( buf, src, body_istream::chunked );
+    std::vector<char> out;
+    BOOST_CHECK_THROW( in.read_all( out ), fc::parse_error_exception );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rejects_long_chunk_lines)
+{
+  read_buffer    buf;
+  chunked_source src( "5;" + std::string( 10000, 'e' ) + "\r\nhello\r\n0\r\n\r\n", 4096 );
+  body_istream   in( buf, src, body_istream::chunked );
+  std::vector<char> out;
+  BOOST_CHECK_THROW( in.read_all( out ), fc::parse_error_exception );
+}
+
+BOOST_AUTO_TEST_CASE(read_all_limits_chunked_bodies)
+{
+  std::string msg;
+  for( int i = 0; i < 10; ++i ) msg += "64\r\n" + std::string( 100, 'x' ) + "\r\n";
+  msg += "0\r\n\r\n";
+  {
+    read_buffer    buf;
+    chunked_source src( msg, 64 );
+    body_istream   in( buf, src, body_istream::chunked );
+    std::vector<char> out;
+    BOOST_CHECK_THROW( in.read_all( out, 999 ), fc::out_of_range_exception );
+  }
+  {
+    read_buffer    buf;
+    chunked_source src( msg, 64 );
+    body_istream   in( buf, src, body_istream::chunked );
+    std::vector<char> out;
+    in.read_all( out, 1000 );
+    BOOST_CHECK_EQUAL( out.size(), 1000u );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(decodes_what_chunked_ostream_encodes)
+{
+  string_sink sink;
+  {
+    fc::http::chunked_ostream out( sink );
+    out.write( "abc", 3 );
+    out.write( "", 0 );
+    std::string big( 70000, 'b' );
+    out.write( big.data(), big.size() );
+    out.close();
+    BOOST_CHECK( out.closed() );
+  }
+  BOOST_CHECK_EQUAL( decode_chunked( sink.data, 1000 ), "abc" + std::string( 70000, 'b' ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,47 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/network/http/client.hpp>
+#include <fc/exception/exception.hpp>
+
+using fc::http::detail::split_url;
+
+BOOST_AUTO_TEST_SUITE(http_client_tests)
+
+BOOST_AUTO_TEST_CASE(split_url_defaults_port_and_target)
+{
+  fc::string host, target;
+  uint16_t   port = 0;
+  split_url( "http://example.com", host, port, target );
+  BOOST_CHECK_EQUAL( host, "example.com" );
+  BOOST_CHECK_EQUAL( port, 80 );
+  BOOST_CHECK_EQUAL( target, "/" );
+}
+
+BOOST_AUTO_TEST_CASE(split_url_takes_port_and_target)
+{
+  fc::string host, target;
+  uint16_t   port = 0;
+  split_url( "http://127.0.0.1:8080/a/b?q=1#f", host, port, target );
+  BOOST_CHECK_EQUAL( host, "127.0.0.1" );
+  BOOST_CHECK_EQUAL( port, 8080 );
+  BOOST_CHECK_EQUAL( target, "/a/b?q=1#f" );
+
+  split_url( "http://h:65535/", host, port, target );
+  BOOST_CHECK_EQUAL( port, 65535 );
+  BOOST_CHECK_EQUAL( target, "/" );
+}
+
+BOOST_AUTO_TEST_CASE(split_url_rejects_malformed_urls)
+{
+  fc::string host, target;
+  uint16_t   port = 0;
+  BOOST_CHECK_THROW( split_url( "https://example.com/", host, port, target ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( split_url( "example.com/", host, port, target ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( split_url( "http:///path", host, port, target ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( split_url( "http://:80/", host, port, target ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( split_url( "http://h:65536/", host, port, target ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( split_url( "http://h:8a/", host, port, target ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( split_url( "http://h:99999999999999999999/", host, port, target ), fc::invalid_arg_exception );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,74 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/network/http/compression.hpp>
+#include <fc/exception/exception.hpp>
+#include <string>
+
+namespace content_coding = fc::http::content_coding;
+
+BOOST_AUTO_TEST_SUITE(compression_tests)
+
+BOOST_AUTO_TEST_CASE(negotiate_prefers_gzip_when_as_good)
+{
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzip" ), content_coding::gzip );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "deflate" ), content_coding::deflate );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "deflate, gzip" ), content_coding::gzip );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzip, deflate, br" ), content_coding::gzip );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( " X-GZIP ;q=1 " ), content_coding::gzip );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "*" ), content_coding::gzip );
+}
+
+BOOST_AUTO_TEST_CASE(negotiate_follows_quality_values)
+{
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzip;q=0.5, deflate" ), content_coding::deflate );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzip;q=0.501, deflate;q=0.5" ), content_coding::gzip );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzip; q=0.001" ), content_coding::gzip );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzip;q=0, deflate;q=0.1" ), content_coding::deflate );
+  // * stands for the codings that are not listed
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzip;q=0, *" ), content_coding::deflate );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "deflate;q=0.2, *;q=0.1" ), content_coding::deflate );
+}
+
+BOOST_AUTO_TEST_CASE(negotiate_falls_back_on_identity)
+{
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "" ), content_coding::identity );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "identity" ), content_coding::identity );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "br, compress" ), content_coding::identity );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzip;q=0" ), content_coding::identity );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzip;q=0.000, deflate;q=0" ), content_coding::identity );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "*;q=0" ), content_coding::identity );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( " , ,, " ), content_coding::identity );
+  BOOST_CHECK_EQUAL( content_coding::negotiate( "gzipx, xdeflate" ), content_coding::identity );
+}
+
+BOOST_AUTO_TEST_CASE(tag_appends_the_coding)
+{
+  BOOST_CHECK_EQUAL( content_coding::tag( "\"1-2\"", content_coding::gzip ), "\"1-2-gzip\"" );
+  BOOST_CHECK_EQUAL( content_coding::tag( "W/\"1-2\"", content_coding::deflate ), "W/\"1-2-deflate\"" );
+  BOOST_CHECK_EQUAL( content_coding::tag( "\"1-2\"", content_coding::identity ), "\"1-2\"" );
+  BOOST_CHECK_EQUAL( content_coding::tag( "unquoted", content_coding::gzip ), "unquoted" );
+}
+
+BOOST_AUTO_TEST_CASE(inflater_limits_the_decompressed_size)
+{
+  std::string body( 100000, 'a' );
+  std::vector<char> compressed;
+  fc::http::deflater d( content_coding::gzip );
+  d.compress( body.data(), body.size(), compressed, fc::http::deflater::finish );
+  BOOST_CHECK( compressed.size() < 1000u );
+
+  {
+    fc::http::inflater z;
+    std::vector<char> out;
+    BOOST_CHECK_THROW( z.decompress( compressed.data(), compressed.size(), out, 99999 ), fc::out_of_range_exception );
+  }
+  {
+    fc::http::inflater z;
+    std::vector<char> out;
+    BOOST_CHECK_EQUAL( z.decompress( compressed.data(), compressed.size(), out, 100000 ), compressed.size() );
+    BOOST_CHECK( z.done() );
+    BOOST_CHECK( std::string( out.begin(), out.end() ) == body );
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,83 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/network/http/file_handler.hpp>
+
+using fc::http::detail::etag_matches;
+using fc::http::detail::parse_range;
+namespace detail = fc::http::detail;
+
+BOOST_AUTO_TEST_SUITE(file_handler_tests)
+
+BOOST_AUTO_TEST_CASE(etag_matches_any_tag_of_the_list)
+{
+  const fc::string etag = "\"10-5f-3\"";
+  BOOST_CHECK( etag_matches( "\"10-5f-3\"", etag ) );
+  BOOST_CHECK( etag_matches( "\"a\", \"10-5f-3\"", etag ) );
+  BOOST_CHECK( etag_matches( " \"a\" ,\t\"10-5f-3\" \t", etag ) );
+  BOOST_CHECK( etag_matches( "W/\"10-5f-3\"", etag ) );
+  BOOST_CHECK( etag_matches( "*", etag ) );
+  BOOST_CHECK( etag_matches( "\"a\", *", etag ) );
+
+  BOOST_CHECK( !etag_matches( "\"10-5f\"", etag ) );
+  BOOST_CHECK( !etag_matches( "\"10-5f-3\"x", etag ) );
+  BOOST_CHECK( !etag_matches( "10-5f-3", etag ) );
+  BOOST_CHECK( !etag_matches( "**", etag ) );
+  BOOST_CHECK( !etag_matches( "", etag ) );
+  BOOST_CHECK( !etag_matches( ", ,", etag ) );
+}
+
+BOOST_AUTO_TEST_CASE(parse_range_takes_a_single_byte_range)
+{
+  uint64_t first = 0, last = 0;
+  BOOST_CHECK_EQUAL( parse_range( "bytes=10-19", 100, first, last ), detail::satisfiable );
+  BOOST_CHECK_EQUAL( first, 10u );
+  BOOST_CHECK_EQUAL( last, 19u );
+
+  // an open or too long end stops at the last byte
+  BOOST_CHECK_EQUAL( parse_range( "bytes=90-", 100, first, last ), detail::satisfiable );
+  BOOST_CHECK_EQUAL( first, 90u );
+  BOOST_CHECK_EQUAL( last, 99u );
+  BOOST_CHECK_EQUAL( parse_range( "bytes=90-1000", 100, first, last ), detail::satisfiable );
+  BOOST_CHECK_EQUAL( last, 99u );
+
+  // a suffix
+  BOOST_CHECK_EQUAL( parse_range( "bytes=-10", 100, first, last ), detail::satisfiable );
+  BOOST_CHECK_EQUAL( first, 90u );
+  BOOST_CHECK_EQUAL( last, 99u );
+  BOOST_CHECK_EQUAL( parse_range( "bytes=-1000", 100, first, last ), detail::satisfiable );
+  BOOST_CHECK_EQUAL( first, 0u );
+  BOOST_CHECK_EQUAL( last, 99u );
+}
+
+BOOST_AUTO_TEST_CASE(parse_range_tells_unsatisfiable_ranges)
+{
+  uint64_t first = 0, last = 0;
+  BOOST_CHECK_EQUAL( parse_range( "bytes=100-", 100, first, last ), detail::not_satisfiable );
+  BOOST_CHECK_EQUAL( parse_range( "bytes=100-200", 100, first, last ), detail::not_satisfiable );
+  BOOST_CHECK_EQUAL( parse_range( "bytes=-0", 100, first, last ), detail::not_satisfiable );
+  BOOST_CHECK_EQUAL( parse_range( "bytes=-5", 0, first, last ), detail::not_satisfiable );
+  BOOST_CHECK_EQUAL( parse_range( "bytes=0-", 0, first, last ), detail::not_satisfiable );
+}
+
+BOOST_AUTO_TEST_CASE(parse_range_ignores_anything_else)
+{
+  uint64_t first = 0, last = 0;
+  const char* ignored[] = {
+    "",
+    "bytes=",
+    "bytes=-",
+    "bytes=5",
+    "bytes=20-10",           // reversed
+    "bytes=0-1,5-6",         // several ranges
+    "bytes=0-1 ",
+    "bytes= 0-1",
+    "bytes=a-1",
+    "items=0-1",
+    "Bytes=0-1",
+    "bytes=99999999999999999999-"
+  };
+  for( size_t i = 0; i < sizeof(ignored) / sizeof(ignored[0]); ++i )
+    BOOST_CHECK_MESSAGE( parse_range( ignored[i], 100, first, last ) == detail::no_range, ignored[i] );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,116 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/network/http/header_index.hpp>
+#include <fc/network/http/connection.hpp>
+#include <string>
+#include <vector>
+#include <string.h>
+
+using fc::http::header_index;
+namespace header_id = fc::http::header_id;
+
+namespace {
+  /** the names of a message and their index */
+  struct fields {
+    void add( const std::string& n ) {
+      names.push_back( n );
+      idx.add( n.data(), n.size() );
+    }
+    uint32_t find( const std::string& n )const {
+      return idx.find( n.data(), n.size(), [&]( uint32_t i ) {
+        return fc::const_buffer( names[i].data(), names[i].size() );
+      } );
+    }
+    std::vector<std::string> names;
+    header_index             idx;
+  };
+}
+
+BOOST_AUTO_TEST_SUITE(header_index_tests)
+
+BOOST_AUTO_TEST_CASE(looks_up_known_names_ignoring_case)
+{
+  for( int i = 1; i < header_id::count; ++i ) {
+    header_id::type id = header_id::type(i);
+    std::string n = header_id::name( id );
+    BOOST_CHECK_EQUAL( header_id::lookup( n.data(), n.size() ), id );
+    std::string upper = n, lower = n;
+    for( size_t c = 0; c < n.size(); ++c ) {
+      upper[c] = char( toupper( n[c] ) );
+      lower[c] = char( tolower( n[c] ) );
+    }
+    BOOST_CHECK_EQUAL( header_id::lookup( upper.data(), upper.size() ), id );
+    BOOST_CHECK_EQUAL( header_id::lookup( lower.data(), lower.size() ), id );
+  }
+  BOOST_CHECK_EQUAL( header_id::lookup( "Hosts", 5 ), header_id::unknown );
+  BOOST_CHECK_EQUAL( header_id::lookup( "Hos", 3 ), header_id::unknown );
+  BOOST_CHECK_EQUAL( header_id::lookup( "", 0 ), header_id::unknown );
+}
+
+BOOST_AUTO_TEST_CASE(compares_and_hashes_ignoring_case)
+{
+  BOOST_CHECK( fc::http::iequals( "X-Request-Id", 12, "x-rEQUEST-iD", 12 ) );
+  BOOST_CHECK( !fc::http::iequals( "X-Request-Id", 12, "X-Request-Ix", 12 ) );
+  BOOST_CHECK( !fc::http::iequals( "X-Request-Id", 12, "X-Request-I", 11 ) );
+  // only ASCII letters fold, '[' and '{' stay apart
+  BOOST_CHECK( !fc::http::iequals( "[", 1, "{", 1 ) );
+  BOOST_CHECK_EQUAL( fc::http::header_hash( "X-Request-Id", 12 ), fc::http::header_hash( "x-request-id", 12 ) );
+  BOOST_CHECK( fc::http::header_hash( "X-Request-Id", 12 ) != fc::http::header_hash( "X-Request-Ix", 12 ) );
+}
+
+BOOST_AUTO_TEST_CASE(finds_the_first_field_of_a_name)
+{
+  fields f;
+  f.add( "Host" );
+  f.add( "X-Custom" );
+  f.add( "content-length" );
+  f.add( "x-custom" );
+  f.add( "HOST" );
+  BOOST_CHECK_EQUAL( f.idx.size(), 5u );
+
+  BOOST_CHECK_EQUAL( f.idx.find( header_id::host ), 0u );
+  BOOST_CHECK_EQUAL( f.idx.find( header_id::content_length ), 2u );
+  BOOST_CHECK_EQUAL( f.idx.find( header_id::etag ), header_index::npos );
+
+  BOOST_CHECK_EQUAL( f.find( "HoSt" ), 0u );
+  BOOST_CHECK_EQUAL( f.find( "X-CUSTOM" ), 1u );
+  BOOST_CHECK_EQUAL( f.find( "Content-Length" ), 2u );
+  BOOST_CHECK_EQUAL( f.find( "X-Other" ), header_index::npos );
+}
+
+BOOST_AUTO_TEST_CASE(add_returns_the_id_and_clear_forgets)
+{
+  header_index idx;
+  BOOST_CHECK_EQUAL( idx.add( "ETag", 4 ), header_id::etag );
+  BOOST_CHECK_EQUAL( idx.add( "X-Custom", 8 ), header_id::unknown );
+  BOOST_CHECK_EQUAL( idx.find( header_id::etag ), 0u );
+  idx.clear();
+  BOOST_CHECK_EQUAL( idx.size(), 0u );
+  BOOST_CHECK_EQUAL( idx.find( header_id::etag ), header_index::npos );
+  idx.add( "X-Custom", 8 );
+  idx.add( "etag", 4 );
+  BOOST_CHECK_EQUAL( idx.find( header_id::etag ), 1u );
+}
+
+BOOST_AUTO_TEST_CASE(messages_index_fields_appended_after_a_lookup)
+{
+  fc::http::request r;
+  r.headers.push_back( fc::http::header( "Host", "example.com" ) );
+  BOOST_CHECK_EQUAL( r.get_header( header_id::host ), "example.com" );
+  BOOST_CHECK_EQUAL( r.get_header( "x-late" ), "" );
+  r.headers.push_back( fc::http::header( "X-Late", "1" ) );
+  r.headers.push_back( fc::http::header( "If-None-Match", "\"a\"" ) );
+  BOOST_CHECK_EQUAL( r.get_header( "x-late" ), "1" );
+  BOOST_CHECK_EQUAL( r.get_header( header_id::if_none_match ), "\"a\"" );
+
+  // fields taken out are noticed as long as fewer remain than were indexed
+  fc::http::reply rep;
+  rep.headers.push_back( fc::http::header( "ETag", "\"a\"" ) );
+  rep.headers.push_back( fc::http::header( "X-A", "a" ) );
+  BOOST_CHECK_EQUAL( rep.get_header( header_id::etag ), "\"a\"" );
+  rep.headers.erase( rep.headers.begin() );
+  BOOST_CHECK_EQUAL( rep.get_header( header_id::etag ), "" );
+  BOOST_CHECK_EQUAL( rep.get_header( "X-A" ), "a" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
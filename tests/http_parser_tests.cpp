@@ -0,0 +1,173 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/network/http/parser.hpp>
+#include <fc/exception/exception.hpp>
+#include <string>
+#include <string.h>
+
+using fc::http::head_parser;
+namespace header_id = fc::http::header_id;
+
+namespace {
+  std::string str( const std::string& msg, const head_parser::field& f ) {
+    return msg.substr( f.offset, f.length );
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(head_parser_tests)
+
+BOOST_AUTO_TEST_CASE(parses_request_line_and_fields)
+{
+  std::string msg = "GET /index.html?q=1 HTTP/1.1\r\n"
+                    "Host: example.com\r\n"
+                    "Content-Length:   12  \r\n"
+                    "X-Empty:\r\n"
+                    "\r\n"
+                    "body follows";
+  head_parser p( head_parser::request_head );
+  size_t len = p.parse( msg.data(), msg.size() );
+  BOOST_REQUIRE( p.complete() );
+  BOOST_CHECK_EQUAL( len, msg.find( "body" ) );
+  BOOST_CHECK_EQUAL( str( msg, p.method() ),  "GET" );
+  BOOST_CHECK_EQUAL( str( msg, p.target() ),  "/index.html?q=1" );
+  BOOST_CHECK_EQUAL( str( msg, p.version() ), "HTTP/1.1" );
+
+  BOOST_REQUIRE_EQUAL( p.headers().size(), 3u );
+  BOOST_CHECK_EQUAL( str( msg, p.headers()[0].key ), "Host" );
+  BOOST_CHECK_EQUAL( str( msg, p.headers()[0].val ), "example.com" );
+  // surrounding whitespace is not part of the value
+  BOOST_CHECK_EQUAL( str( msg, p.headers()[1].val ), "12" );
+  BOOST_CHECK_EQUAL( p.headers()[2].val.length, 0u );
+}
+
+BOOST_AUTO_TEST_CASE(parses_status_line)
+{
+  std::string msg = "HTTP/1.1 404 Not Found\r\n\r\n";
+  head_parser p( head_parser::response_head );
+  BOOST_CHECK_EQUAL( p.parse( msg.data(), msg.size() ), msg.size() );
+  BOOST_CHECK_EQUAL( p.status(), 404 );
+  BOOST_CHECK_EQUAL( str( msg, p.reason() ),  "Not Found" );
+  BOOST_CHECK_EQUAL( str( msg, p.version() ), "HTTP/1.1" );
+
+  // the reason phrase may be left out
+  std::string bare = "HTTP/1.0 200\n\n";
+  p.reset();
+  BOOST_CHECK_EQUAL( p.parse( bare.data(), bare.size() ), bare.size() );
+  BOOST_CHECK_EQUAL( p.status(), 200 );
+  BOOST_CHECK_EQUAL( p.reason().length, 0u );
+}
+
+BOOST_AUTO_TEST_CASE(parses_byte_by_byte)
+{
+  std::string msg = "POST /a HTTP/1.1\r\nHost: h\r\nContent-Type: text/plain\r\n\r\n";
+  head_parser p( head_parser::request_head );
+  for( size_t i = 1; i < msg.size(); ++i )
+    BOOST_REQUIRE_EQUAL( p.parse( msg.data(), i ), 0u );
+  BOOST_CHECK_EQUAL( p.parse( msg.data(), msg.size() ), msg.size() );
+  BOOST_CHECK_EQUAL( str( msg, p.method() ), "POST" );
+  BOOST_CHECK_EQUAL( p.headers().size(), 2u );
+  // once complete further calls return the same length
+  BOOST_CHECK_EQUAL( p.parse( msg.data(), msg.size() ), msg.size() );
+}
+
+BOOST_AUTO_TEST_CASE(skips_empty_lines_before_request_line)
+{
+  std::string msg = "\r\n\r\nGET / HTTP/1.1\r\n\r\n";
+  head_parser p( head_parser::request_head );
+  BOOST_CHECK_EQUAL( p.parse( msg.data(), msg.size() ), msg.size() );
+  BOOST_CHECK_EQUAL( str( msg, p.target() ), "/" );
+}
+
+BOOST_AUTO_TEST_CASE(finds_fields_by_id_and_name)
+{
+  std::string msg = "GET / HTTP/1.1\r\ncontent-LENGTH: 5\r\nX-Custom: a\r\nx-custom: b\r\n\r\n";
+  head_parser p( head_parser::request_head );
+  p.parse( msg.data(), msg.size() );
+  const head_parser::header_field* f = p.find( header_id::content_length );
+  BOOST_REQUIRE( f );
+  BOOST_CHECK_EQUAL( str( msg, f->val ), "5" );
+  BOOST_CHECK( !p.find( header_id::host ) );
+
+  // the first of several fields with the same name
+  f = p.find( msg.data(), "X-CUSTOM", 8 );
+  BOOST_REQUIRE( f );
+  BOOST_CHECK_EQUAL( str( msg, f->val ), "a" );
+  BOOST_CHECK( !p.find( msg.data(), "X-Other", 7 ) );
+}
+
+BOOST_AUTO_TEST_CASE(rejects_malformed_heads)
+{
+  const char* bad[] = {
+    "GET\r\n\r\n",
+    "GET / FTP/1.1\r\n\r\n",
+    " GET / HTTP/1.1\r\n\r\n",
+    "GET / HTTP/1.1\r\nNoColon\r\n\r\n",
+    "GET / HTTP/1.1\r\n: empty name\r\n\r\n",
+    "GET / HTTP/1.1\r\nBad Name: v\r\n\r\n",
+    "GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n"
+  };
+  for( size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i ) {
+    head_parser p( head_parser::request_head );
+    BOOST_CHECK_THROW( p.parse( bad[i], strlen( bad[i] ) ), fc::parse_error_exception );
+  }
+
+  const char* bad_status[] = { "HTTP/1.1 20 OK\r\n\r\n", "HTTP/1.1 2x0 OK\r\n\r\n", "HTTX/1.1 200 OK\r\n\r\n" };
+  for( size_t i = 0; i < sizeof(bad_status)/sizeof(bad_status[0]); ++i ) {
+    head_parser p( head_parser::response_head );
+    BOOST_CHECK_THROW( p.parse( bad_status[i], strlen( bad_status[i] ) ), fc::parse_error_exception );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(enforces_limits)
+{
+  std::string big = "GET / HTTP/1.1\r\nX: " + std::string( 200, 'x' );
+  head_parser p( head_parser::request_head, 128 );
+  BOOST_CHECK_THROW( p.parse( big.data(), big.size() ), fc::parse_error_exception );
+
+  std::string many = "GET / HTTP/1.1\r\nA: 1\r\nB: 2\r\nC: 3\r\n\r\n";
+  head_parser q( head_parser::request_head, 64*1024, 2 );
+  BOOST_CHECK_THROW( q.parse( many.data(), many.size() ), fc::parse_error_exception );
+}
+
+BOOST_AUTO_TEST_CASE(frames_the_body)
+{
+  std::string msg = "POST / HTTP/1.1\r\nContent-Length: 5\r\ncontent-length: 5\r\n\r\n";
+  head_parser p( head_parser::request_head );
+  BOOST_REQUIRE( p.parse( msg.data(), msg.size() ) );
+  head_parser::framing f = p.body_framing( msg.data() );
+  BOOST_CHECK( f.has_length && !f.transfer_encoded && !f.chunked );
+  BOOST_CHECK_EQUAL( f.length, 5u );
+
+  msg = "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\nTransfer-Encoding: Chunked;x=1\r\n\r\n";
+  head_parser q( head_parser::request_head );
+  BOOST_REQUIRE( q.parse( msg.data(), msg.size() ) );
+  f = q.body_framing( msg.data() );
+  BOOST_CHECK( f.transfer_encoded && f.chunked && !f.has_length );
+}
+
+BOOST_AUTO_TEST_CASE(rejects_ambiguous_request_framing)
+{
+  const char* bad[] = {
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 5\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: chunked\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 5, 5\r\n\r\n"
+  };
+  for( size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i ) {
+    head_parser p( head_parser::request_head );
+    BOOST_REQUIRE( p.parse( bad[i], strlen( bad[i] ) ) );
+    BOOST_CHECK_THROW( p.body_framing( bad[i] ), fc::parse_error_exception );
+  }
+
+  // a reply whose last coding is not chunked is delimited by the end of the connection instead
+  std::string msg = "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip\r\nContent-Length: 5\r\n\r\n";
+  head_parser r( head_parser::response_head );
+  BOOST_REQUIRE( r.parse( msg.data(), msg.size() ) );
+  head_parser::framing f = r.body_framing( msg.data() );
+  BOOST_CHECK( f.transfer_encoded && !f.chunked );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
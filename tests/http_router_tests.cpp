@@ -0,0 +1,150 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/network/http/router.hpp>
+#include <fc/exception/exception.hpp>
+#include <string>
+
+using fc::http::router;
+
+namespace {
+  /** a handler that tells which route it belongs to */
+  router::handler route( int id, int& called ) {
+    return [id,&called]( const fc::http::request&, const fc::http::server::response&, const router::params& ) {
+      called = id;
+    };
+  }
+
+  /** @return the id of the route found for method and path, 0 if none */
+  int find( const router& r, const fc::string& method, const fc::string& path, int& called, 
+            router::params* p = nullptr ) {
+    router::params tmp;
+    if( !p ) p = &tmp;
+    const router::handler* h = r.find( method, path, *p );
+    if( !h ) return 0;
+    called = 0;
+    (*h)( fc::http::request(), fc::http::server::response(), *p );
+    return called;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(router_tests)
+
+BOOST_AUTO_TEST_CASE(finds_static_routes_sharing_prefixes)
+{
+  int called = 0;
+  router r;
+  r.add( "GET", "/abc", route( 1, called ) );
+  r.add( "GET", "/abd", route( 2, called ) );
+  r.add( "GET", "/ab", route( 3, called ) );
+  r.add( "GET", "/", route( 4, called ) );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/abc", called ), 1 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/abd", called ), 2 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/ab", called ), 3 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/", called ), 4 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/a", called ), 0 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/abcd", called ), 0 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "", called ), 0 );
+  // without the query and fragment
+  BOOST_CHECK_EQUAL( find( r, "GET", "/abc?x=1#f", called ), 1 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/ab#f", called ), 3 );
+}
+
+BOOST_AUTO_TEST_CASE(captures_segments_and_the_rest)
+{
+  int called = 0;
+  router r;
+  r.add( "GET", "/users/:id/posts/:post", route( 1, called ) );
+  r.add( "GET", "/static/*file", route( 2, called ) );
+
+  router::params p;
+  BOOST_CHECK_EQUAL( find( r, "GET", "/users/42/posts/a%20b?q", called, &p ), 1 );
+  BOOST_REQUIRE_EQUAL( p.path_params().size(), 2u );
+  BOOST_CHECK_EQUAL( p.path_params()[0].key, "id" );
+  BOOST_CHECK_EQUAL( p.get( "id" ), "42" );
+  BOOST_CHECK_EQUAL( p.get( "post" ), "a b" );
+  BOOST_CHECK( p.has( "post" ) );
+  BOOST_CHECK( !p.has( "file" ) );
+  BOOST_CHECK_EQUAL( p.get( "file" ), "" );
+
+  router::params s;
+  BOOST_CHECK_EQUAL( find( r, "GET", "/static/css/site%2Bdark.css", called, &s ), 2 );
+  BOOST_CHECK_EQUAL( s.get( "file" ), "css/site+dark.css" );
+  router::params e;
+  BOOST_CHECK_EQUAL( find( r, "GET", "/static/", called, &e ), 2 );
+  BOOST_CHECK_EQUAL( e.get( "file" ), "" );
+
+  // a capture never matches an empty segment
+  BOOST_CHECK_EQUAL( find( r, "GET", "/users//posts/1", called ), 0 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/users/42/posts", called ), 0 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/users/42/posts/1/x", called ), 0 );
+}
+
+BOOST_AUTO_TEST_CASE(prefers_static_segments_then_backtracks)
+{
+  int called = 0;
+  router r;
+  r.add( "GET", "/users/new", route( 1, called ) );
+  r.add( "GET", "/users/:id", route( 2, called ) );
+  r.add( "POST", "/files/upload", route( 3, called ) );
+  r.add( "GET", "/files/:name", route( 4, called ) );
+  r.add( "GET", "/files/*rest", route( 5, called ) );
+
+  BOOST_CHECK_EQUAL( find( r, "GET", "/users/new", called ), 1 );
+  router::params p;
+  BOOST_CHECK_EQUAL( find( r, "GET", "/users/newer", called, &p ), 2 );
+  BOOST_CHECK_EQUAL( p.get( "id" ), "newer" );
+
+  // the static route is of another method
+  router::params f;
+  BOOST_CHECK_EQUAL( find( r, "POST", "/files/upload", called ), 3 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/files/upload", called, &f ), 4 );
+  BOOST_CHECK_EQUAL( f.get( "name" ), "upload" );
+  BOOST_REQUIRE_EQUAL( f.path_params().size(), 1u );
+
+  // the capture does not match the whole path, the wildcard does
+  router::params w;
+  BOOST_CHECK_EQUAL( find( r, "GET", "/files/a/b", called, &w ), 5 );
+  BOOST_REQUIRE_EQUAL( w.path_params().size(), 1u );
+  BOOST_CHECK_EQUAL( w.get( "rest" ), "a/b" );
+}
+
+BOOST_AUTO_TEST_CASE(matches_methods)
+{
+  int called = 0;
+  router r;
+  r.add( "GET", "/page", route( 1, called ) );
+  r.add( "*", "/any", route( 2, called ) );
+  r.add( "DELETE", "/any", route( 3, called ) );
+
+  BOOST_CHECK_EQUAL( find( r, "GET", "/page", called ), 1 );
+  BOOST_CHECK_EQUAL( find( r, "HEAD", "/page", called ), 1 );
+  BOOST_CHECK_EQUAL( find( r, "POST", "/page", called ), 0 );
+  BOOST_CHECK_EQUAL( find( r, "PUT", "/any", called ), 2 );
+  BOOST_CHECK_EQUAL( find( r, "DELETE", "/any", called ), 3 );
+}
+
+BOOST_AUTO_TEST_CASE(rejects_malformed_and_conflicting_routes)
+{
+  int called = 0;
+  router r;
+  r.add( "GET", "/users/:id", route( 1, called ) );
+  r.add( "GET", "/files/*path", route( 2, called ) );
+
+  BOOST_CHECK_THROW( r.add( "GET", "", route( 3, called ) ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( r.add( "GET", "users", route( 3, called ) ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( r.add( "GET", "/a/:", route( 3, called ) ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( r.add( "GET", "/a/*rest/b", route( 3, called ) ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( r.add( "GET", "/users/:id", route( 3, called ) ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( r.add( "POST", "/users/:name", route( 3, called ) ), fc::invalid_arg_exception );
+  BOOST_CHECK_THROW( r.add( "POST", "/files/*other", route( 3, called ) ), fc::invalid_arg_exception );
+
+  // ':' and '*' inside a segment are plain text
+  r.add( "GET", "/a:b*c", route( 4, called ) );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/a:b*c", called ), 4 );
+  // the same template with another method is fine
+  r.add( "POST", "/users/:id", route( 5, called ) );
+  BOOST_CHECK_EQUAL( find( r, "POST", "/users/7", called ), 5 );
+  BOOST_CHECK_EQUAL( find( r, "GET", "/users/7", called ), 1 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()